@@ -1,4 +1,7 @@
 #include "../database/database.h"
+#include "../database/archive.h"
+#include "../database/pipeline.h"
+#include "../database/tick_ring.h"
 #include "../exec/client.h"
 
 #include <iostream>
@@ -6,6 +9,8 @@
 #include <stdlib.h>
 #include <fstream>
 #include <thread>
+#include <sstream>
+#include <sched.h>
 
 using namespace std;
 
@@ -13,7 +18,8 @@ ostream &operator<<(ostream &os, Bar const &bar)
 {
   return os << "Ticker: " << bar.ticker << endl << "Hour: " << bar.hour << endl
             << "Minute: " << bar.minute << endl << "Open: " << bar.open << endl << "Close: "
-            << bar.close << endl << "Low: " << bar.low << endl << "High: " << bar.high << endl;
+            << bar.close << endl << "Low: " << bar.low << endl << "High: " << bar.high << endl
+            << "Volume: " << bar.volume << endl << "VWAP: " << bar.vwap() << endl << "Ticks: " << bar.ticks << endl;
 }
 
 ostream &operator<<(ostream &os, Time* const &time)
@@ -32,17 +38,101 @@ ostream &operator<<(ostream &os, Time* const &time)
 //   }
 // }
 
+// Ticks from the ingester's shared memory ring through the threaded pipeline: an EMA(20) / SMA(64)
+// crossover on every tracked ticker, priced off the cached top of book. PIPELINE_CORES takes a
+// comma separated core per stage (ingest, normalize, bars, signals, routing), -1 for unpinned.
+int run_pipeline(Database& database, TickRing& ring)
+{
+  Pipeline pipeline(database);
+  stringstream cores(getenv("PIPELINE_CORES") ? getenv("PIPELINE_CORES") : "");
+  string core;
+  for (int stage = 0; getline(cores, core, ','); stage++)
+  {
+    char* end;
+    long parsed = strtol(core.c_str(), &end, 10);
+    if (stage >= Pipeline::STAGES || end == core.c_str() || *end != '\0' || parsed < -1 || parsed >= CPU_SETSIZE)
+    {
+      cerr << "PIPELINE_CORES must be up to " << Pipeline::STAGES << " comma separated cores, -1 for unpinned" << endl;
+      return 1;
+    }
+    pipeline.cores[stage] = parsed;
+  }
+
+  pipeline.source = [&ring](Tick& tick) { return ring.read(tick); };
+  // only the signal thread touches this
+  unordered_map<string, bool> above;
+  pipeline.strategy = [&database, &above](const Tick& tick, Signal& signal) {
+    double ema = database.get_ema(tick.ticker, 20), sma = database.get_sma(tick.ticker, 64);
+    if (ema == 0 || sma == 0) return false;
+    bool now = ema > sma;
+    unordered_map<string, bool>::iterator previous = above.find(tick.ticker);
+    bool crossed = previous != above.end() && previous->second != now;
+    above[tick.ticker] = now;
+    if (!crossed) return false;
+
+    Quote quote;
+    signal.ticker = tick.ticker;
+    signal.buy = now;
+    signal.quantity = 1;
+    signal.limit_price = database.quotes.get(tick.ticker, quote) && quote.valid() ? (now ? quote.bid_price : quote.ask_price) : 0;
+    signal.time = tick.time;
+    return true;
+  };
+  pipeline.router = [](const Signal& signal) {
+    cout << (signal.buy ? "BUY " : "SELL ") << signal.quantity << " " << signal.ticker << " @ " << signal.limit_price << endl;
+    // async so the routing stage isn't held up for the round trip, keep the future to check the fill
+    // client.submit_order_async(signal.ticker, signal.quantity, signal.buy ? alpaca::OrderSide::Buy : alpaca::OrderSide::Sell,
+    //                           alpaca::OrderType::Limit, alpaca::OrderTimeInForce::Day, to_string(signal.limit_price));
+  };
+
+  pipeline.start();
+  while (1)
+  {
+    this_thread::sleep_for(chrono::seconds(10));
+    pipeline.report(cerr);
+    uint64_t lost = ring.lost.load(memory_order_relaxed);
+    if (lost > 0) cerr << "tick ring overran " << lost << " ticks" << endl;
+  }
+  return 0;
+}
+
 int main(int argc, char* argv[])
 {
-  string ticker = argv[1];
-  Database database(ticker);
+  Database database;
+
+  // `main --archive` snapshots today's collections into the columnar archive and exits
+  if (argc > 1 && string(argv[1]) == "--archive")
+  {
+    bool ok = true;
+    for (const string& symbol : database.tickers) ok = database.archive_day(symbol, archive_date()) && ok;
+    return ok ? 0 : 1;
+  }
+
+  if (database.tickers.empty())
+  {
+    cerr << "No tickers to follow, list them one per line in " << (getenv("TICKER_PATH") ? getenv("TICKER_PATH") : "tickers") << endl;
+    return 1;
+  }
+  string ticker = argc > 1 ? argv[1] : database.tickers[0];
 
-  while (database.sma_bars.size != database.sma_bars.max_size) {}
+  // the ingester's shared memory ring when it runs on this host, otherwise the change stream
+  const char* ring_name = getenv("TICK_RING");
+  TickRing ring;
+  if (ring_name != nullptr && ring.open(ring_name)) return run_pipeline(database, ring);
+  if (!database.watch()) cerr << "Falling back to polling for bars" << endl;
+  unsigned long version = 0;
   while (1)
   {
-    // database.update_bars(ticker);
+    if (database.watching) version = database.wait_for_update(version);
+    else
+    {
+      this_thread::sleep_for(chrono::seconds(1));
+      database.update_bars();
+    }
     // cout << *(database.sma_bars.begin().value());
-    cout << database.get_sma(ticker, 64) << endl;
+    Database::Indicators::Macd macd = database.get_macd(ticker);
+    cout << database.get_sma(ticker, 64) << " " << database.get_ema(ticker, 20) << " "
+         << macd.line << " " << macd.signal.value << " " << macd.histogram << endl;
   }
   // auto env = alpaca::Environment();
   // if (auto status = env.parse(); !status.ok())
@@ -52,8 +142,11 @@ int main(int argc, char* argv[])
   // }
   // auto client = alpaca::Client(env);
 
+  // // join the bid from the cached top of book instead of a fixed price
+  // Quote quote;
+  // string limit = database.quotes.get("AAPL", quote) ? to_string(quote.bid_price) : "3.00";
   // auto buy_response =
-  //     client.submit_order("AAPL", 1, alpaca::OrderSide::Buy, alpaca::OrderType::Limit, alpaca::OrderTimeInForce::Day, "3.00");
+  //     client.submit_order("AAPL", 1, alpaca::OrderSide::Buy, alpaca::OrderType::Limit, alpaca::OrderTimeInForce::Day, limit);
 
   // if (auto status = buy_response.first; !status.ok())
   // {
@@ -0,0 +1,80 @@
+#include "../database/database.h"
+#include "../database/archive.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <queue>
+
+using namespace std;
+
+// Replays archived days for every ticker in TICKER_PATH through the same Database::on_tick bar
+// builder and indicator state the live algo uses, on a virtual clock and without Mongo.
+//   backtest <yyyymmdd> [<yyyymmdd> ...]
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    cerr << "usage: " << argv[0] << " <yyyymmdd> [<yyyymmdd> ...]" << endl;
+    return 1;
+  }
+
+  vector<string> tickers = Database::load_tickers(getenv("TICKER_PATH") ? getenv("TICKER_PATH") : "tickers");
+  Database database(tickers, false);
+  VirtualClock clock;
+  Clock::set(&clock);
+
+  uint64_t replayed = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int d = 1; d < argc; d++)
+  {
+    uint32_t date = strtoul(argv[d], NULL, 10);
+    // roll at the start of each new day so the summary still sees the last day's session
+    if (d > 1) database.roll_day();
+    vector<Archive> archives;
+    for (const string& ticker : tickers)
+    {
+      Archive archive(archive_path(ticker, date));
+      if (archive.isOpen()) archives.push_back(move(archive));
+      else cerr << "No archive for " << ticker << " on " << date << endl;
+    }
+
+    // merge the symbols on time so every tick is replayed in the order the day saw it
+    typedef pair<int64_t, size_t> Next;
+    priority_queue<Next, vector<Next>, greater<Next>> next;
+    vector<uint64_t> position(archives.size(), 0);
+    for (size_t i = 0; i < archives.size(); i++)
+    {
+      if (archives[i].count > 0) next.push(make_pair(archives[i].time[0], i));
+    }
+
+    clock.time = 0;
+    while (!next.empty())
+    {
+      size_t i = next.top().second;
+      next.pop();
+      uint64_t& p = position[i];
+      clock.advance(archives[i].time[p]);
+      database.on_tick(archives[i].tick(p));
+      replayed++;
+      if (++p < archives[i].count) next.push(make_pair(archives[i].time[p], i));
+    }
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  for (const string& ticker : tickers)
+  {
+    Database::Queue& bars = database.sma_bars.at(ticker);
+    if (bars.isEmpty()) continue;
+    Database::Indicators::Macd macd = database.get_macd(ticker);
+    cout << ticker << " close " << bars.back().close << " sma64 " << database.get_sma(ticker, 64)
+         << " ema20 " << database.get_ema(ticker, 20) << " macd " << macd.line << " " << macd.signal.value
+         << " " << macd.histogram << " vwap " << database.get_vwap(ticker) << endl;
+  }
+  cout << "Replayed " << replayed << " ticks in " << seconds << "s (" << (seconds > 0 ? replayed / seconds : 0)
+       << " ticks/s)" << endl;
+
+  Clock::set(nullptr);
+  return 0;
+}
@@ -0,0 +1,227 @@
+#include "../database/database.h"
+#include "../database/columns.h"
+#include "../exec/client.h"
+#include "../exec/order.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace std;
+
+// Hot path microbenchmarks, `make bench` runs them and writes the results as JSON.
+
+static Bar make_bar(unsigned int i) {
+  double close = 100 + (i % 17) * 0.25;
+  return Bar("SPY", 9 + i / 60 % 7, i % 60, close, close, close - 0.5, close + 0.5, 100);
+}
+
+static void BM_QueueEnqueue(benchmark::State& state) {
+  Database::Queue queue(BAR_WINDOW);
+  Bar bar = make_bar(0);
+  for (auto _ : state) {
+    queue.enqueue(bar);
+    benchmark::DoNotOptimize(queue.back());
+  }
+}
+BENCHMARK(BM_QueueEnqueue);
+
+static void BM_QueueEnqueueDequeue(benchmark::State& state) {
+  Database::Queue queue(BAR_WINDOW);
+  Bar bar = make_bar(0);
+  for (auto _ : state) {
+    queue.enqueue(bar);
+    queue.dequeue();
+    benchmark::DoNotOptimize(queue.size);
+  }
+}
+BENCHMARK(BM_QueueEnqueueDequeue);
+
+// scan of the last `n` closes, what get_sma did before the indicators were incremental
+static void BM_QueueScan(benchmark::State& state) {
+  Database::Queue queue(BAR_WINDOW);
+  for (unsigned int i = 0; i < BAR_WINDOW; i++) queue.enqueue(make_bar(i));
+  unsigned short n = state.range(0);
+  for (auto _ : state) {
+    double sum = 0;
+    for (Database::Queue::iterator iter = queue.begin_from_end(); iter != queue.end(); iter--) {
+      sum += iter.value()->close;
+      if (--n == 0) break;
+    }
+    n = state.range(0);
+    benchmark::DoNotOptimize(sum);
+  }
+}
+BENCHMARK(BM_QueueScan)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+
+static void BM_GetSma(benchmark::State& state) {
+  Database database({"SPY"}, false);
+  Tick tick;
+  tick.ticker = "SPY";
+  tick.last_size = 100;
+  for (unsigned int i = 0; i < BAR_WINDOW; i++) {
+    tick.hour = 9 + i / 60;
+    tick.minute = i % 60;
+    tick.last_price = make_bar(i).close;
+    database.on_tick(tick);
+  }
+  unsigned short period = state.range(0);
+  for (auto _ : state) benchmark::DoNotOptimize(database.get_sma("SPY", period));
+}
+BENCHMARK(BM_GetSma)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+
+// one tick through the bar builder and every tracked indicator, revising the live bar
+static void BM_OnTick(benchmark::State& state) {
+  Database database({"SPY"}, false);
+  database.get_sma("SPY", 64);
+  database.get_ema("SPY", 20);
+  Tick tick;
+  tick.ticker = "SPY";
+  tick.hour = 9;
+  tick.minute = 30;
+  tick.last_size = 100;
+  unsigned int i = 0;
+  for (auto _ : state) {
+    tick.last_price = 100 + (i++ % 17) * 0.25;
+    benchmark::DoNotOptimize(database.on_tick(tick));
+  }
+}
+BENCHMARK(BM_OnTick);
+
+// reading the time of day from the calibrated clock against the clock_gettime + localtime_r it replaced
+static void BM_ClockNow(benchmark::State& state) {
+  WallClock clock;
+  for (auto _ : state) benchmark::DoNotOptimize(clock.now());
+}
+BENCHMARK(BM_ClockNow);
+
+static void BM_LocalTime(benchmark::State& state) {
+  for (auto _ : state) {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    tm local;
+    localtime_r(&now.tv_sec, &local);
+    benchmark::DoNotOptimize(local);
+  }
+}
+BENCHMARK(BM_LocalTime);
+
+// publishing a quote and reading the snapshot back, the cost a limit price decision pays
+static void BM_QuoteUpdate(benchmark::State& state) {
+  QuoteBook book({"SPY"});
+  unsigned int i = 0;
+  for (auto _ : state) {
+    double bid = 100 + (i++ % 17) * 0.01;
+    benchmark::DoNotOptimize(book.update("SPY", bid, bid + 0.01, 300, 200, i));
+  }
+}
+BENCHMARK(BM_QuoteUpdate);
+
+static void BM_QuoteGet(benchmark::State& state) {
+  QuoteBook book({"SPY"});
+  book.update("SPY", 100, 100.01, 300, 200, 0);
+  Quote quote;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(book.get("SPY", quote));
+    benchmark::DoNotOptimize(quote.midprice());
+  }
+}
+BENCHMARK(BM_QuoteGet);
+
+// one cross-sectional scan of a 5000 symbol universe, arg 1 uses the AVX2 kernels, 0 the scalar ones
+static Columns make_columns() {
+  Columns columns(5000, BAR_WINDOW);
+  for (size_t s = 0; s < columns.symbols; s++) {
+    columns.counts[s] = BAR_WINDOW;
+    for (size_t b = 0; b < columns.bars; b++) columns.row(b)[s] = make_bar(s + b).close;
+  }
+  return columns;
+}
+
+template <void (*Kernel)(const Columns&, unsigned short, double*)>
+static void BM_Columns(benchmark::State& state) {
+  Columns columns = make_columns();
+  vector<double> out(columns.symbols);
+  bool avx2 = columns_avx2;
+  columns_avx2 = avx2 && state.range(0);
+  for (auto _ : state) {
+    Kernel(columns, 20, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  columns_avx2 = avx2;
+  state.SetItemsProcessed(state.iterations() * columns.symbols);
+}
+BENCHMARK_TEMPLATE(BM_Columns, column_sma)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Columns, column_ema)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Columns, column_rsi)->Arg(0)->Arg(1);
+BENCHMARK_TEMPLATE(BM_Columns, column_stddev)->Arg(0)->Arg(1);
+
+// decoding the documents a get_bars cursor yields, without the round trip
+static void BM_DecodeBars(benchmark::State& state) {
+  vector<bsoncxx::document::value> documents;
+  for (int i = 0; i < state.range(0); i++) {
+    documents.push_back(make_document(
+      kvp("_id", make_document(kvp("HOUR", 9 + i / 60), kvp("MINUTE", i % 60))),
+      kvp("open", 100.0 + i), kvp("close", 100.5 + i), kvp("low", 99.5 + i), kvp("high", 101.0 + i),
+      kvp("volume", 1000 + i)
+    ));
+  }
+  Bar bar;
+  for (auto _ : state) {
+    for (const bsoncxx::document::value& document : documents) {
+      bsoncxx::document::view id = document.view()["_id"].get_document().value;
+      to_bar("SPY", (unsigned short) get_number(id["HOUR"]), (unsigned short) get_number(id["MINUTE"]), document.view(), bar);
+      benchmark::DoNotOptimize(bar);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeBars)->Arg(1)->Arg(64)->Arg(390);
+
+// decoding raw tick documents, what the change stream and archive_day do per insert
+static void BM_DecodeTicks(benchmark::State& state) {
+  vector<bsoncxx::document::value> documents;
+  for (int i = 0; i < state.range(0); i++) {
+    documents.push_back(make_document(
+      kvp("key", "SPY"), kvp("LAST_PRICE", 400.0 + (i % 10) * 0.01), kvp("LAST_SIZE", 100),
+      kvp("BID_PRICE", 399.99), kvp("ASK_PRICE", 400.01), kvp("BID_SIZE", 3), kvp("ASK_SIZE", 5),
+      kvp("HOUR", 9), kvp("MINUTE", 30 + i % 30), kvp("SECOND", i % 60)
+    ));
+  }
+  for (auto _ : state) {
+    for (const bsoncxx::document::value& document : documents) benchmark::DoNotOptimize(to_tick("SPY", document.view()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DecodeTicks)->Arg(1000);
+
+static const char* ORDER_JSON =
+  "{\"id\":\"61e69015-8549-4bfd-b9c3-01e75843f47d\",\"client_order_id\":\"eb9e2aaa-f71a-4f51-b5b4-52a6c565dad4\","
+  "\"created_at\":\"2021-03-16T18:38:01.942282Z\",\"updated_at\":\"2021-03-16T18:38:01.942282Z\","
+  "\"submitted_at\":\"2021-03-16T18:38:01.937734Z\",\"filled_at\":null,\"expired_at\":null,\"canceled_at\":null,"
+  "\"failed_at\":null,\"replaced_at\":null,\"replaced_by\":null,\"replaces\":null,"
+  "\"asset_id\":\"b0b6dd9d-8b9b-48a9-ba46-b9d54906e415\",\"symbol\":\"AAPL\",\"asset_class\":\"us_equity\","
+  "\"notional\":null,\"qty\":\"10\",\"filled_qty\":\"0\",\"filled_avg_price\":null,\"order_class\":\"\","
+  "\"order_type\":\"limit\",\"type\":\"limit\",\"side\":\"buy\",\"time_in_force\":\"day\",\"limit_price\":\"123.45\","
+  "\"stop_price\":null,\"status\":\"accepted\",\"extended_hours\":false,\"legs\":null}";
+
+static void BM_OrderFromJSON(benchmark::State& state) {
+  string json = ORDER_JSON;
+  for (auto _ : state) {
+    alpaca::Order order;
+    benchmark::DoNotOptimize(order.fromJSON(json));
+    benchmark::DoNotOptimize(order);
+  }
+}
+BENCHMARK(BM_OrderFromJSON);
+
+static void BM_SubmitOrderBody(benchmark::State& state) {
+  alpaca::TakeProfitParams take_profit{"130.00"};
+  alpaca::StopLossParams stop_loss{"120.00", "119.50"};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(alpaca::submitOrderBody("AAPL", 10, alpaca::OrderSide::Buy, alpaca::OrderType::Limit,
+      alpaca::OrderTimeInForce::Day, "123.45", "", false, "eb9e2aaa-f71a-4f51-b5b4-52a6c565dad4",
+      alpaca::OrderClass::Bracket, &take_profit, &stop_loss));
+  }
+}
+BENCHMARK(BM_SubmitOrderBody);
+
+BENCHMARK_MAIN();
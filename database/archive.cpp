@@ -0,0 +1,257 @@
+#include "archive.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
+static uint64_t align(uint64_t offset) {
+  return (offset + 63) & ~(uint64_t) 63;
+}
+
+bool Archive::open(string path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(ArchiveHeader)) {
+    ::close(fd);
+    return false;
+  }
+  void* data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) return false;
+
+  const ArchiveHeader* mapped = (const ArchiveHeader*) data;
+  bool valid = memcmp(mapped->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) == 0 && mapped->version == ARCHIVE_VERSION;
+  for (unsigned int i = 0; valid && i < COLUMNS; i++) {
+    uint64_t width = i == TIME ? sizeof(int64_t) : sizeof(double);
+    valid = mapped->columns[i] + mapped->count * width <= (uint64_t) info.st_size;
+  }
+  // ticks() and get_bar scan straight from these, so a bad entry would read past the columns
+  for (unsigned int m = 0; valid && m <= MINUTES_PER_DAY; m++) {
+    valid = mapped->minute_index[m] <= mapped->count && (m == 0 || mapped->minute_index[m] >= mapped->minute_index[m - 1]);
+  }
+  if (!valid) {
+    munmap(data, info.st_size);
+    return false;
+  }
+
+  data_ = data;
+  length_ = info.st_size;
+  header = mapped;
+  count = header->count;
+  symbol_ = string(header->symbol, strnlen(header->symbol, sizeof(header->symbol)));
+  const char* base = (const char*) data;
+  time = (const int64_t*) (base + header->columns[TIME]);
+  last = (const double*) (base + header->columns[LAST]);
+  size = (const double*) (base + header->columns[SIZE]);
+  bid = (const double*) (base + header->columns[BID]);
+  ask = (const double*) (base + header->columns[ASK]);
+  bid_size = (const double*) (base + header->columns[BID_SIZE]);
+  ask_size = (const double*) (base + header->columns[ASK_SIZE]);
+  // scans are sequential, let the kernel read ahead
+  madvise(data, length_, MADV_SEQUENTIAL);
+  return true;
+}
+
+void Archive::close() {
+  if (data_ != nullptr) munmap(data_, length_);
+  data_ = nullptr;
+  length_ = 0;
+  header = nullptr;
+  symbol_ = "";
+  time = nullptr;
+  last = size = bid = ask = bid_size = ask_size = nullptr;
+  count = 0;
+}
+
+Archive::Archive(Archive&& other) {
+  *this = move(other);
+}
+
+Archive& Archive::operator=(Archive&& other) {
+  if (this == &other) return *this;
+  close();
+  header = other.header;
+  time = other.time;
+  last = other.last;
+  size = other.size;
+  bid = other.bid;
+  ask = other.ask;
+  bid_size = other.bid_size;
+  ask_size = other.ask_size;
+  count = other.count;
+  data_ = other.data_;
+  length_ = other.length_;
+  symbol_ = other.symbol_;
+  other.data_ = nullptr;
+  other.close();
+  return *this;
+}
+
+string Archive::symbol() {
+  return symbol_;
+}
+
+pair<uint64_t, uint64_t> Archive::ticks(unsigned short minute_start, unsigned short minute_end) {
+  if (header == nullptr || minute_start > minute_end || minute_start >= MINUTES_PER_DAY) return make_pair(0, 0);
+  if (minute_end >= MINUTES_PER_DAY) minute_end = MINUTES_PER_DAY - 1;
+  return make_pair(header->minute_index[minute_start], header->minute_index[minute_end + 1]);
+}
+
+Tick Archive::tick(uint64_t i) {
+  Tick tick;
+  tick.ticker = symbol_;
+  tick.time = time[i];
+  tick.last_price = last[i];
+  tick.last_size = size[i];
+  tick.bid_price = bid[i];
+  tick.ask_price = ask[i];
+  tick.bid_size = bid_size[i];
+  tick.ask_size = ask_size[i];
+  int64_t seconds = time[i] / 1000000000LL;
+  tick.hour = seconds / 3600;
+  tick.minute = (seconds / 60) % 60;
+  tick.second = seconds % 60;
+  return tick;
+}
+
+bool Archive::get_bar(unsigned short hour, unsigned short minute, Bar& bar) {
+  unsigned short minute_of_day = hour * 60 + minute;
+  pair<uint64_t, uint64_t> range = ticks(minute_of_day, minute_of_day);
+  if (range.first == range.second) return false;
+
+  // only trades make the bar, quote only ticks have LAST 0
+  double open = 0, close = 0, low = 0, high = 0, volume = 0, notional = 0;
+  unsigned long trades = 0;
+  for (uint64_t i = range.first; i < range.second; i++) {
+    if (last[i] == 0) continue;
+    if (trades++ == 0) open = low = high = last[i];
+    if (last[i] < low) low = last[i];
+    if (last[i] > high) high = last[i];
+    close = last[i];
+    volume += size[i];
+    notional += last[i] * size[i];
+  }
+  if (trades == 0) return false;
+  bar = Bar(symbol_, hour, minute, open, close, low, high, volume);
+  bar.notional = notional;
+  bar.ticks = trades;
+  return true;
+}
+
+vector<Bar> Archive::get_bars(unsigned short hour_start, unsigned short hour_end, unsigned short minute_start, unsigned short minute_end) {
+  vector<Bar> bars;
+  Bar bar;
+  for (unsigned short i = hour_start * 60 + minute_start; i <= hour_end * 60 + minute_end && i < MINUTES_PER_DAY; i++) {
+    if (get_bar(i / 60, i % 60, bar)) bars.push_back(bar);
+  }
+  return bars;
+}
+
+bool write_archive(string path, string symbol, uint32_t date, const vector<Tick>& ticks) {
+  ArchiveHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+  header.version = ARCHIVE_VERSION;
+  header.date = date;
+  strncpy(header.symbol, symbol.c_str(), sizeof(header.symbol) - 1);
+  header.count = ticks.size();
+
+  uint64_t offset = align(sizeof(ArchiveHeader));
+  for (unsigned int i = 0; i < COLUMNS; i++) {
+    header.columns[i] = offset;
+    offset = align(offset + header.count * 8);
+  }
+
+  // minute_index[m] = first tick at or after minute m
+  uint64_t next = 0;
+  for (unsigned short m = 0; m <= MINUTES_PER_DAY; m++) {
+    int64_t start = (int64_t) m * 60 * 1000000000LL;
+    while (next < ticks.size() && ticks[next].time < start) next++;
+    header.minute_index[m] = next;
+  }
+  header.minute_index[MINUTES_PER_DAY] = header.count;
+
+  vector<int64_t> time(ticks.size());
+  vector<double> columns[COLUMNS];
+  for (unsigned int i = LAST; i < COLUMNS; i++) columns[i].resize(ticks.size());
+  Tick previous;
+  double total_volume = 0;
+  for (size_t i = 0; i < ticks.size(); i++) {
+    const Tick& tick = ticks[i];
+    time[i] = tick.time;
+    // LAST stays 0 on quote only ticks, as on_tick reads them, so replays don't take them for trades.
+    // sizes are resolved here, as on_tick would, since the archive doesn't keep TOTAL_VOLUME
+    columns[LAST][i] = tick.last_price;
+    columns[SIZE][i] = tick.last_price != 0 ? trade_size(tick, total_volume) : 0;
+    columns[BID][i] = tick.bid_price != 0 ? tick.bid_price : previous.bid_price;
+    columns[ASK][i] = tick.ask_price != 0 ? tick.ask_price : previous.ask_price;
+    columns[BID_SIZE][i] = tick.bid_size != 0 ? tick.bid_size : previous.bid_size;
+    columns[ASK_SIZE][i] = tick.ask_size != 0 ? tick.ask_size : previous.ask_size;
+    previous.bid_price = columns[BID][i];
+    previous.ask_price = columns[ASK][i];
+    previous.bid_size = columns[BID_SIZE][i];
+    previous.ask_size = columns[ASK_SIZE][i];
+  }
+
+  // write to a temporary name and rename so readers never map a half written file
+  string temp = path + ".tmp";
+  ofstream file(temp, ios::binary | ios::trunc);
+  if (!file) return false;
+  static const char padding[64] = {0};
+  file.write((const char*) &header, sizeof(header));
+  for (unsigned int i = 0; i < COLUMNS; i++) {
+    file.write(padding, header.columns[i] - file.tellp());
+    if (i == TIME) file.write((const char*) time.data(), time.size() * sizeof(int64_t));
+    else file.write((const char*) columns[i].data(), columns[i].size() * sizeof(double));
+  }
+  file.close();
+  if (!file) return false;
+  return rename(temp.c_str(), path.c_str()) == 0;
+}
+
+string archive_path(string symbol, uint32_t date) {
+  const char* root = getenv("ARCHIVE_PATH");
+  return string(root ? root : "archive") + "/" + to_string(date) + "/" + symbol + ".ticks";
+}
+
+uint32_t archive_date() {
+  time_t now = ::time(0);
+  tm local;
+  localtime_r(&now, &local);
+  return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+}
+
+bool Database::archive_day(string ticker, uint32_t date) {
+  vector<Tick> ticks;
+  {
+    mongocxx::pool::entry client = pool_->acquire();
+    // TICK_INDEX doesn't cover the _id tiebreak, so the whole day is sorted in memory on the server
+    mongocxx::cursor result = query_database(*client, ticker,
+      query::sort("HOUR", 1), query::sort("MINUTE", 1), query::sort("SECOND", 1), query::sort("_id", 1), query::allow_disk_use(),
+      query::project("key", "HOUR", "MINUTE", "SECOND", "LAST_PRICE", "LAST_SIZE", "TOTAL_VOLUME", "BID_PRICE", "ASK_PRICE",
+        "BID_SIZE", "ASK_SIZE"),
+      query::exclude("_id"));
+    for (mongocxx::cursor::iterator iter = result.begin(); iter != result.end(); iter++) ticks.push_back(to_tick(ticker, *iter));
+  }
+
+  string path = archive_path(ticker, date);
+  error_code error;
+  filesystem::create_directories(filesystem::path(path).parent_path(), error);
+  if (!write_archive(path, ticker, date, ticks)) {
+    cerr << "Unable to write archive " << path << endl;
+    return false;
+  }
+  cout << "Archived " << ticks.size() << " ticks for " << ticker << " to " << path << endl;
+  return true;
+}
+
+Archive Database::open_archive(string ticker, uint32_t date) {
+  return Archive(archive_path(ticker, date));
+}
@@ -0,0 +1,99 @@
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "database.h"
+
+using namespace std;
+
+// Day-partitioned, per-symbol columnar tick file. Layout, in host byte order:
+//
+//   ArchiveHeader
+//   time[count]        int64 nanoseconds since midnight exchange time, ascending
+//   last[count]        double, 0 on quote only ticks
+//   size[count]        double, each trade's size resolved with trade_size, 0 on quote only ticks
+//   bid[count]         double
+//   ask[count]         double
+//   bid_size[count]    double
+//   ask_size[count]    double
+//
+// Each column starts on a 64 byte boundary at the offset recorded in the header, and
+// minute_index[m] is the first tick at or after minute m of the day (minute_index[1440] == count),
+// so a bar or a minute range is two index reads and a contiguous scan of the mapped columns.
+const char ARCHIVE_MAGIC[8] = {'T', 'I', 'C', 'K', 'A', 'R', 'C', '1'};
+const uint32_t ARCHIVE_VERSION = 2;
+const unsigned short MINUTES_PER_DAY = 24 * 60;
+
+enum ArchiveColumn {
+  TIME,
+  LAST,
+  SIZE,
+  BID,
+  ASK,
+  BID_SIZE,
+  ASK_SIZE,
+  COLUMNS,
+};
+
+struct ArchiveHeader {
+  char magic[8];
+  uint32_t version;
+  // yyyymmdd
+  uint32_t date;
+  char symbol[16];
+  uint64_t count;
+  uint64_t columns[COLUMNS];
+  uint64_t minute_index[MINUTES_PER_DAY + 1];
+};
+
+// read-only mapping of one archive file, columns point straight into the mapping
+struct Archive {
+  const ArchiveHeader* header = nullptr;
+  const int64_t* time = nullptr;
+  const double* last = nullptr;
+  const double* size = nullptr;
+  const double* bid = nullptr;
+  const double* ask = nullptr;
+  const double* bid_size = nullptr;
+  const double* ask_size = nullptr;
+  uint64_t count = 0;
+
+  bool open(string path);
+  void close();
+  bool isOpen() { return header != nullptr; }
+  string symbol();
+
+  // [first, last) tick indexes for minutes of day [minute_start, minute_end]
+  pair<uint64_t, uint64_t> ticks(unsigned short minute_start, unsigned short minute_end);
+  Tick tick(uint64_t i);
+  bool get_bar(unsigned short hour, unsigned short minute, Bar& bar);
+  vector<Bar> get_bars(unsigned short hour_start, unsigned short hour_end, unsigned short minute_start, unsigned short minute_end);
+
+  Archive() {}
+  Archive(string path) { open(path); }
+  Archive(const Archive&) = delete;
+  Archive& operator=(const Archive&) = delete;
+  Archive(Archive&& other);
+  Archive& operator=(Archive&& other);
+  ~Archive() { close(); }
+
+  private:
+    void* data_ = nullptr;
+    size_t length_ = 0;
+    string symbol_;
+};
+
+// writes `ticks` (sorted by time) for one symbol and day. Quote fields a tick didn't carry are
+// filled forward from the previous tick; LAST and SIZE are 0 on ticks that weren't trades, and
+// trade sizes are resolved from total_volume
+bool write_archive(string path, string symbol, uint32_t date, const vector<Tick>& ticks);
+
+// <ARCHIVE_PATH or "archive">/<date>/<symbol>.ticks
+string archive_path(string symbol, uint32_t date);
+// today's local date as yyyymmdd
+uint32_t archive_date();
+
+#endif // ARCHIVE_H_
@@ -0,0 +1,92 @@
+#include "database.h"
+
+// fold a finer bar (or a single trade) into a coarser one
+static void merge(Bar& bar, bool& empty, const Bar& finer) {
+  if (empty) {
+    string ticker = bar.ticker;
+    unsigned short hour = bar.hour, minute = bar.minute, second = bar.second;
+    unsigned int timeframe = bar.timeframe;
+    bar = finer;
+    bar.ticker = ticker;
+    bar.hour = hour;
+    bar.minute = minute;
+    bar.second = second;
+    bar.timeframe = timeframe;
+    empty = false;
+    return;
+  }
+  bar.close = finer.close;
+  if (finer.low < bar.low) bar.low = finer.low;
+  if (finer.high > bar.high) bar.high = finer.high;
+  bar.volume += finer.volume;
+  bar.notional += finer.notional;
+  bar.ticks += finer.ticks;
+}
+
+static void start(BarBuilder::Frame& frame, const string& ticker, unsigned int timeframe, unsigned int seconds) {
+  frame.start = seconds - seconds % timeframe;
+  frame.empty = true;
+  frame.bar = Bar();
+  frame.bar.ticker = ticker;
+  frame.bar.hour = frame.start / 3600;
+  frame.bar.minute = frame.start / 60 % 60;
+  frame.bar.second = frame.start % 60;
+  frame.bar.timeframe = timeframe;
+}
+
+unsigned int BarBuilder::level(Timeframe timeframe) {
+  for (unsigned int i = 0; i < TIMEFRAME_COUNT; i++) {
+    if (TIMEFRAMES[i] == timeframe) return i;
+  }
+  return 0;
+}
+
+bool BarBuilder::on_tick(double price, double size, unsigned int seconds) {
+  closed_mask = 0;
+  if (frames[0].start > (int) seconds) return false;
+
+  // frames nest, so once one is still live every coarser one is too
+  for (unsigned int i = 0; i < TIMEFRAME_COUNT; i++) {
+    Frame& frame = frames[i];
+    if (frame.start == (int) (seconds - seconds % TIMEFRAMES[i])) break;
+    if (frame.start >= 0 && !frame.empty) {
+      closed[i] = frame.bar;
+      closed_mask |= 1 << i;
+      if (i + 1 < TIMEFRAME_COUNT) merge(frames[i + 1].bar, frames[i + 1].empty, frame.bar);
+    }
+    start(frame, ticker, TIMEFRAMES[i], seconds);
+  }
+
+  Bar trade;
+  trade.open = trade.close = trade.low = trade.high = price;
+  trade.volume = size;
+  trade.notional = price * size;
+  trade.ticks = 1;
+  merge(frames[0].bar, frames[0].empty, trade);
+  return true;
+}
+
+void BarBuilder::seed(const vector<Bar>& bars, unsigned int level, unsigned int seconds) {
+  for (unsigned int i = 0; i < TIMEFRAME_COUNT; i++) start(frames[i], ticker, TIMEFRAMES[i], seconds);
+  // each bar goes where on_tick would have left it: the live bar of its own frame, or once
+  // finished, the first coarser frame whose bucket it falls in
+  for (const Bar& bar : bars) {
+    int at = (bar.hour * 60 + bar.minute) * 60 + bar.second;
+    for (unsigned int i = level; i < TIMEFRAME_COUNT; i++) {
+      if (at < frames[i].start) continue;
+      merge(frames[i].bar, frames[i].empty, bar);
+      break;
+    }
+  }
+}
+
+bool BarBuilder::current(unsigned int level, Bar& bar) {
+  if (frames[level].start < 0) return false;
+  bar = frames[level].bar;
+  bool empty = frames[level].empty;
+  // the finer live bars haven't been rolled up yet, coarsest first so open stays the earliest
+  for (int i = level - 1; i >= 0; i--) {
+    if (!frames[i].empty) merge(bar, empty, frames[i].bar);
+  }
+  return !empty;
+}
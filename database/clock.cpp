@@ -0,0 +1,139 @@
+#include "clock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+static WallClock wall_clock;
+static std::atomic<Clock*> current_clock{&wall_clock};
+
+Clock* Clock::current() {
+  return current_clock.load(std::memory_order_acquire);
+}
+
+void Clock::set(Clock* clock) {
+  current_clock.store(clock != nullptr ? clock : &wall_clock, std::memory_order_release);
+}
+
+// calibrate the TSC against CLOCK_MONOTONIC over at least this long before trusting it
+static const int64_t CALIBRATION = NANOS_PER_SECOND / 100;
+static const int64_t NANOS_PER_HOUR = 3600 * NANOS_PER_SECOND;
+
+static int64_t clock_monotonic() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * NANOS_PER_SECOND + now.tv_nsec;
+}
+
+static uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// only a TSC that ticks at a constant rate through frequency and power state changes will do
+static bool invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+  return edx & (1 << 8);
+#else
+  return false;
+#endif
+}
+
+// a TSC reading and CLOCK_MONOTONIC taken together, bracketed by two TSC reads and keeping the
+// tightest of a few tries so a preemption between them doesn't skew the calibration
+static void sample(uint64_t& tsc, int64_t& monotonic) {
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < 5; i++) {
+    uint64_t before = read_tsc();
+    int64_t now = clock_monotonic();
+    uint64_t after = read_tsc();
+    if (after - before >= best) continue;
+    best = after - before;
+    tsc = before + (after - before) / 2;
+    monotonic = now;
+  }
+}
+
+WallClock::WallClock() {
+  tsc_ = invariant_tsc();
+  sample(tsc_start_, monotonic_start_);
+}
+
+int64_t WallClock::monotonic() {
+  if (!tsc_) return clock_monotonic();
+  uint64_t before, after, tsc_base;
+  int64_t base;
+  double nanos_per_tick;
+  do {
+    before = sequence_.load(std::memory_order_acquire);
+    tsc_base = tsc_base_.load(std::memory_order_relaxed);
+    base = base_.load(std::memory_order_relaxed);
+    nanos_per_tick = nanos_per_tick_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence_.load(std::memory_order_relaxed);
+  } while (before != after || (before & 1));
+  // not calibrated yet
+  if (nanos_per_tick == 0) return clock_monotonic();
+  return base + (int64_t) ((double) (read_tsc() - tsc_base) * nanos_per_tick);
+}
+
+int64_t WallClock::now() {
+  int64_t time = monotonic();
+  if (time >= refresh_at_.load(std::memory_order_acquire)) refresh();
+  return time - midnight_.load(std::memory_order_acquire);
+}
+
+void WallClock::refresh() {
+  // one thread refreshes, the rest carry on with the current offset
+  if (refreshing_.exchange(true, std::memory_order_acquire)) return;
+
+  uint64_t tsc;
+  int64_t monotonic;
+  sample(tsc, monotonic);
+  timespec real;
+  clock_gettime(CLOCK_REALTIME, &real);
+  tm local;
+  localtime_r(&real.tv_sec, &local);
+
+  // rebase the TSC on CLOCK_MONOTONIC, unless the current rate has already run past it, in which
+  // case it is rebased where the rate put it so the count never steps back
+  int64_t base = monotonic;
+  double nanos_per_tick = nanos_per_tick_.load(std::memory_order_relaxed);
+  if (nanos_per_tick != 0) base = std::max(base, base_.load(std::memory_order_relaxed) + (int64_t) ((double) (tsc - tsc_base_.load(std::memory_order_relaxed)) * nanos_per_tick));
+  if (tsc_ && monotonic - monotonic_start_ >= CALIBRATION && tsc > tsc_start_) nanos_per_tick = (double) (monotonic - monotonic_start_) / (tsc - tsc_start_);
+
+  int64_t since_midnight = ((int64_t) (local.tm_hour * 60 + local.tm_min) * 60 + local.tm_sec) * NANOS_PER_SECOND + real.tv_nsec;
+  int64_t midnight = midnight_.load(std::memory_order_relaxed);
+  // the same day in the same UTC offset keeps the old midnight, so the count never steps back
+  // within a day when NTP nudges the wall clock
+  if (local.tm_yday != day_ || local.tm_gmtoff != offset_ || refresh_at_.load(std::memory_order_relaxed) == 0) {
+    midnight = base - since_midnight;
+    day_ = local.tm_yday;
+    offset_ = local.tm_gmtoff;
+  }
+  int64_t refresh_at = base + NANOS_PER_HOUR - since_midnight % NANOS_PER_HOUR;
+  // recalibrate on a baseline ten times longer each time (10ms, 100ms, 1s, ...) until the
+  // hourly refresh takes over
+  if (tsc_) refresh_at = std::min(refresh_at, monotonic_start_ + std::max(CALIBRATION, 10 * (monotonic - monotonic_start_)));
+
+  uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  tsc_base_.store(tsc, std::memory_order_relaxed);
+  base_.store(base, std::memory_order_relaxed);
+  nanos_per_tick_.store(nanos_per_tick, std::memory_order_relaxed);
+  sequence_.store(sequence + 2, std::memory_order_release);
+  midnight_.store(midnight, std::memory_order_release);
+  refresh_at_.store(refresh_at, std::memory_order_release);
+  refreshing_.store(false, std::memory_order_release);
+}
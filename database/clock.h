@@ -0,0 +1,61 @@
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+#include <atomic>
+
+const int64_t NANOS_PER_SECOND = 1000000000LL;
+
+// source of exchange local time for Time() and anything else that needs "now"
+struct Clock {
+  // nanoseconds since midnight exchange time
+  virtual int64_t now() = 0;
+  virtual ~Clock() {}
+
+  static Clock* current();
+  // swap the process wide clock, nullptr goes back to the wall clock
+  static void set(Clock* clock);
+};
+
+// Local time of day without a syscall or a lock per read. Time is a monotonic nanosecond count
+// (the TSC scaled by a rate calibrated against CLOCK_MONOTONIC when the CPU has an invariant
+// TSC, CLOCK_MONOTONIC itself otherwise) minus where local midnight falls on that count. The
+// midnight offset comes from one localtime call, which is checked again hourly so the date
+// rolling over or a DST change is picked up; the timezone is the process's, so run with
+// TZ=America/New_York (or wherever the exchange is).
+struct WallClock : Clock {
+  int64_t now() override;
+  // nanoseconds since an arbitrary start, never goes backwards
+  int64_t monotonic();
+
+  WallClock();
+
+  private:
+    // guarded by a sequence number like QuoteBook so readers never block on a refresh
+    std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint64_t> tsc_base_{0};
+    std::atomic<int64_t> base_{0};
+    std::atomic<double> nanos_per_tick_{0};
+    std::atomic<int64_t> midnight_{0};
+    std::atomic<int64_t> refresh_at_{0};
+    std::atomic<bool> refreshing_{false};
+    bool tsc_ = false;
+    // first TSC / CLOCK_MONOTONIC pair, the calibration baseline
+    uint64_t tsc_start_ = 0;
+    int64_t monotonic_start_ = 0;
+    // local day and UTC offset the midnight offset was worked out for
+    int day_ = -1;
+    long offset_ = 0;
+
+    void refresh();
+};
+
+// only moves when told to, so replayed data sees the time of the tick being replayed
+struct VirtualClock : Clock {
+  int64_t time = 0;
+
+  int64_t now() override { return time; }
+  void advance(int64_t _time) { if (_time > time) time = _time; }
+};
+
+#endif // CLOCK_H_
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <immintrin.h>
+#include <algorithm>
+
+#include "columns.h"
+
+// the kernels are built for avx2 and fma together, a CPU can have the first without the second
+bool columns_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+
+Columns::Columns(size_t _symbols, size_t _bars) : symbols(_symbols), bars(_bars), tickers(_symbols), counts(_symbols, 0) {
+  stride = (symbols + COLUMN_LANES - 1) / COLUMN_LANES * COLUMN_LANES;
+  size_t bytes = stride * bars * sizeof(double);
+  if (bytes == 0) return;
+  closes = (double*) aligned_alloc(32, bytes);
+  memset(closes, 0, bytes);
+}
+
+Columns::Columns(Columns&& other) {
+  *this = move(other);
+}
+
+Columns& Columns::operator=(Columns&& other) {
+  if (this == &other) return *this;
+  free(closes);
+  symbols = other.symbols;
+  stride = other.stride;
+  bars = other.bars;
+  tickers = move(other.tickers);
+  counts = move(other.counts);
+  closes = other.closes;
+  other.closes = nullptr;
+  other.symbols = other.stride = other.bars = 0;
+  return *this;
+}
+
+Columns::~Columns() {
+  free(closes);
+}
+
+Columns Database::load_columns() {
+  Columns columns(tickers.size(), BAR_WINDOW);
+  lock_guard<mutex> lock(mutex_);
+  for (size_t s = 0; s < tickers.size(); s++) {
+    Queue& window = sma_bars.at(tickers[s]);
+    columns.tickers[s] = tickers[s];
+    columns.counts[s] = window.size;
+    if (window.isEmpty()) continue;
+    size_t first = columns.bars - window.size;
+    for (size_t b = 0; b < columns.bars; b++) columns.row(b)[s] = window[b < first ? 0 : b - first].close;
+  }
+  return columns;
+}
+
+static void sma_scalar(const Columns& columns, unsigned short period, double* out) {
+  for (size_t s = 0; s < columns.stride; s++) out[s] = 0;
+  for (size_t b = columns.bars - period; b < columns.bars; b++) {
+    const double* row = columns.row(b);
+    for (size_t s = 0; s < columns.stride; s++) out[s] += row[s];
+  }
+  for (size_t s = 0; s < columns.stride; s++) out[s] /= period;
+}
+
+__attribute__((target("avx2")))
+static void sma_avx2(const Columns& columns, unsigned short period, double* out) {
+  __m256d scale = _mm256_set1_pd(1.0 / period);
+  for (size_t s = 0; s < columns.stride; s += COLUMN_LANES) {
+    __m256d sum = _mm256_setzero_pd();
+    for (size_t b = columns.bars - period; b < columns.bars; b++) sum = _mm256_add_pd(sum, _mm256_load_pd(columns.row(b) + s));
+    _mm256_storeu_pd(out + s, _mm256_mul_pd(sum, scale));
+  }
+}
+
+// row of each lane's first real close, bars for padding lanes so they never start
+static vector<double> first_rows(const Columns& columns) {
+  vector<double> first(columns.stride, columns.bars);
+  for (size_t s = 0; s < columns.symbols; s++) first[s] = columns.bars - columns.counts[s];
+  return first;
+}
+
+// EMA and RSI run from each symbol's own first close rather than the back-filled rows, so a
+// short history gives the same value Indicators::Ema would over the same closes
+static void ema_scalar(const Columns& columns, unsigned short period, double* out) {
+  double alpha = 2.0 / (period + 1);
+  vector<double> first = first_rows(columns);
+  vector<double> sum(columns.stride, 0);
+  for (size_t s = 0; s < columns.stride; s++) out[s] = 0;
+  for (size_t b = 0; b < columns.bars; b++) {
+    const double* row = columns.row(b);
+    for (size_t s = 0; s < columns.stride; s++) {
+      // 1 for the symbol's first close
+      double k = b + 1 - first[s];
+      if (k < 1) continue;
+      if (k <= period) {
+        sum[s] += row[s];
+        out[s] = sum[s] / period;
+      }
+      else out[s] = alpha * row[s] + (1 - alpha) * out[s];
+    }
+  }
+}
+
+__attribute__((target("avx2,fma")))
+static void ema_avx2(const Columns& columns, unsigned short period, double* out) {
+  __m256d alpha = _mm256_set1_pd(2.0 / (period + 1));
+  __m256d scale = _mm256_set1_pd(1.0 / period);
+  __m256d one = _mm256_set1_pd(1);
+  __m256d length = _mm256_set1_pd(period);
+  vector<double> first = first_rows(columns);
+  for (size_t s = 0; s < columns.stride; s += COLUMN_LANES) {
+    __m256d start = _mm256_loadu_pd(first.data() + s);
+    __m256d sum = _mm256_setzero_pd();
+    __m256d value = _mm256_setzero_pd();
+    for (size_t b = 0; b < columns.bars; b++) {
+      __m256d close = _mm256_load_pd(columns.row(b) + s);
+      __m256d k = _mm256_sub_pd(_mm256_set1_pd(b + 1), start);
+      __m256d seeding = _mm256_and_pd(_mm256_cmp_pd(k, one, _CMP_GE_OQ), _mm256_cmp_pd(k, length, _CMP_LE_OQ));
+      __m256d smoothing = _mm256_cmp_pd(k, length, _CMP_GT_OQ);
+      sum = _mm256_blendv_pd(sum, _mm256_add_pd(sum, close), seeding);
+      // value + alpha * (close - value)
+      __m256d smoothed = _mm256_fmadd_pd(alpha, _mm256_sub_pd(close, value), value);
+      value = _mm256_blendv_pd(value, _mm256_mul_pd(sum, scale), seeding);
+      value = _mm256_blendv_pd(value, smoothed, smoothing);
+    }
+    _mm256_storeu_pd(out + s, value);
+  }
+}
+
+static void rsi_scalar(const Columns& columns, unsigned short period, double* out) {
+  vector<double> first = first_rows(columns);
+  vector<double> gain(columns.stride, 0), loss(columns.stride, 0);
+  for (size_t b = 1; b < columns.bars; b++) {
+    const double* previous = columns.row(b - 1);
+    const double* row = columns.row(b);
+    for (size_t s = 0; s < columns.stride; s++) {
+      // 1 for the change out of the symbol's first close
+      double j = b - first[s];
+      if (j < 1) continue;
+      double change = row[s] - previous[s];
+      double up = change > 0 ? change : 0, down = change < 0 ? -change : 0;
+      if (j <= period) {
+        gain[s] += up / period;
+        loss[s] += down / period;
+      }
+      else {
+        gain[s] = (gain[s] * (period - 1) + up) / period;
+        loss[s] = (loss[s] * (period - 1) + down) / period;
+      }
+    }
+  }
+  for (size_t s = 0; s < columns.stride; s++) out[s] = loss[s] == 0 ? 100 : 100 - 100 / (1 + gain[s] / loss[s]);
+}
+
+__attribute__((target("avx2")))
+static void rsi_avx2(const Columns& columns, unsigned short period, double* out) {
+  __m256d zero = _mm256_setzero_pd();
+  __m256d hundred = _mm256_set1_pd(100);
+  __m256d one = _mm256_set1_pd(1);
+  __m256d scale = _mm256_set1_pd(1.0 / period);
+  __m256d keep = _mm256_set1_pd(period - 1);
+  __m256d length = _mm256_set1_pd(period);
+  vector<double> first = first_rows(columns);
+  for (size_t s = 0; s < columns.stride; s += COLUMN_LANES) {
+    __m256d start = _mm256_loadu_pd(first.data() + s);
+    __m256d gain = zero, loss = zero;
+    __m256d previous = _mm256_load_pd(columns.row(0) + s);
+    for (size_t b = 1; b < columns.bars; b++) {
+      __m256d close = _mm256_load_pd(columns.row(b) + s);
+      __m256d j = _mm256_sub_pd(_mm256_set1_pd(b), start);
+      __m256d seeding = _mm256_and_pd(_mm256_cmp_pd(j, one, _CMP_GE_OQ), _mm256_cmp_pd(j, length, _CMP_LE_OQ));
+      __m256d smoothing = _mm256_cmp_pd(j, length, _CMP_GT_OQ);
+      __m256d change = _mm256_sub_pd(close, previous);
+      __m256d up = _mm256_max_pd(change, zero);
+      __m256d down = _mm256_max_pd(_mm256_sub_pd(zero, change), zero);
+      __m256d seeded_gain = _mm256_add_pd(gain, _mm256_mul_pd(up, scale));
+      __m256d seeded_loss = _mm256_add_pd(loss, _mm256_mul_pd(down, scale));
+      __m256d smoothed_gain = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(gain, keep), up), scale);
+      __m256d smoothed_loss = _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(loss, keep), down), scale);
+      gain = _mm256_blendv_pd(_mm256_blendv_pd(gain, seeded_gain, seeding), smoothed_gain, smoothing);
+      loss = _mm256_blendv_pd(_mm256_blendv_pd(loss, seeded_loss, seeding), smoothed_loss, smoothing);
+      previous = close;
+    }
+    __m256d rsi = _mm256_sub_pd(hundred, _mm256_div_pd(hundred, _mm256_add_pd(one, _mm256_div_pd(gain, loss))));
+    __m256d flat = _mm256_cmp_pd(loss, zero, _CMP_EQ_OQ);
+    _mm256_storeu_pd(out + s, _mm256_blendv_pd(rsi, hundred, flat));
+  }
+}
+
+static void stddev_scalar(const Columns& columns, unsigned short period, double* out) {
+  vector<double> mean(columns.stride);
+  sma_scalar(columns, period, mean.data());
+  for (size_t s = 0; s < columns.stride; s++) out[s] = 0;
+  for (size_t b = columns.bars - period; b < columns.bars; b++) {
+    const double* row = columns.row(b);
+    for (size_t s = 0; s < columns.stride; s++) out[s] += (row[s] - mean[s]) * (row[s] - mean[s]);
+  }
+  for (size_t s = 0; s < columns.stride; s++) out[s] = sqrt(out[s] / period);
+}
+
+__attribute__((target("avx2,fma")))
+static void stddev_avx2(const Columns& columns, unsigned short period, double* out) {
+  __m256d scale = _mm256_set1_pd(1.0 / period);
+  for (size_t s = 0; s < columns.stride; s += COLUMN_LANES) {
+    __m256d mean = _mm256_setzero_pd();
+    for (size_t b = columns.bars - period; b < columns.bars; b++) mean = _mm256_add_pd(mean, _mm256_load_pd(columns.row(b) + s));
+    mean = _mm256_mul_pd(mean, scale);
+    __m256d squares = _mm256_setzero_pd();
+    for (size_t b = columns.bars - period; b < columns.bars; b++) {
+      __m256d deviation = _mm256_sub_pd(_mm256_load_pd(columns.row(b) + s), mean);
+      squares = _mm256_fmadd_pd(deviation, deviation, squares);
+    }
+    _mm256_storeu_pd(out + s, _mm256_sqrt_pd(_mm256_mul_pd(squares, scale)));
+  }
+}
+
+typedef void (*Kernel)(const Columns& columns, unsigned short period, double* out);
+
+// kernels write whole rows, padding lanes included, so they go through a scratch row; symbols
+// with fewer than `needed` real closes read 0
+static void run(const Columns& columns, unsigned short period, size_t needed, Kernel avx2, Kernel scalar, double* out) {
+  if (period == 0 || needed > columns.bars) {
+    fill(out, out + columns.symbols, 0.0);
+    return;
+  }
+  vector<double> row(columns.stride);
+  (columns_avx2 ? avx2 : scalar)(columns, period, row.data());
+  for (size_t s = 0; s < columns.symbols; s++) out[s] = columns.counts[s] < needed ? 0 : row[s];
+}
+
+void column_sma(const Columns& columns, unsigned short period, double* out) {
+  run(columns, period, period, sma_avx2, sma_scalar, out);
+}
+
+void column_ema(const Columns& columns, unsigned short period, double* out) {
+  run(columns, period, period, ema_avx2, ema_scalar, out);
+}
+
+void column_rsi(const Columns& columns, unsigned short period, double* out) {
+  // period changes need one more close
+  run(columns, period, period + 1, rsi_avx2, rsi_scalar, out);
+}
+
+void column_stddev(const Columns& columns, unsigned short period, double* out) {
+  run(columns, period, period, stddev_avx2, stddev_scalar, out);
+}
@@ -0,0 +1,54 @@
+#ifndef COLUMNS_H_
+#define COLUMNS_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "database.h"
+
+using namespace std;
+
+// Closes for a whole universe as one structure-of-arrays block: row b holds bar b of every
+// symbol side by side, so a kernel walks the rows once and does the same arithmetic for many
+// symbols per instruction. Rows are padded to a multiple of COLUMN_LANES doubles and start on a
+// 32 byte boundary. Histories are aligned on the newest bar (row bars - 1); a symbol with fewer
+// than `bars` closes has its leading rows back-filled with its oldest close and counts[s] says
+// how many are real. The kernels never read the back-filled rows: SMA and stddev only look at
+// the last `period`, and EMA and RSI start from each symbol's first real close.
+const size_t COLUMN_LANES = 4;
+
+struct Columns {
+  size_t symbols = 0;
+  size_t stride = 0;
+  size_t bars = 0;
+  vector<string> tickers;
+  vector<unsigned short> counts;
+  double* closes = nullptr;
+
+  double* row(size_t bar) { return closes + bar * stride; }
+  const double* row(size_t bar) const { return closes + bar * stride; }
+
+  Columns() {}
+  Columns(size_t symbols, size_t bars);
+  Columns(const Columns&) = delete;
+  Columns& operator=(const Columns&) = delete;
+  Columns(Columns&& other);
+  Columns& operator=(Columns&& other);
+  ~Columns();
+};
+
+// Every kernel writes one value per symbol at the newest bar into out[0, symbols), with the
+// same 0-until-ready convention as Database::Indicators. They use AVX2 and FMA when the CPU has
+// both (checked once at startup, set columns_avx2 = false to force the scalar path).
+extern bool columns_avx2;
+
+void column_sma(const Columns& columns, unsigned short period, double* out);
+// seeded with the simple average of the first `period` rows, like Indicators::Ema
+void column_ema(const Columns& columns, unsigned short period, double* out);
+// Wilder's RSI, 0 to 100
+void column_rsi(const Columns& columns, unsigned short period, double* out);
+// population standard deviation of the last `period` closes
+void column_stddev(const Columns& columns, unsigned short period, double* out);
+
+#endif // COLUMNS_H_
@@ -1,116 +1,311 @@
 #include "database.h"
+#include <mongocxx/exception/operation_exception.hpp>
 #include <ctime>
 #include <fstream>
+#include <thread>
 
-Database::Database(string ticker) {
-  string uri = getenv("MONGO_DB_URI");
-  string database = getenv("MONGO_DB_DATABASE");
-
-  client_ = mongocxx::client{
-    mongocxx::uri{uri}
-  };
-  database_ = client_[database];
-  // ifstream tickerFile("tickers");
-  // string temp;
-  // while (getline(tickerFile, temp)) {
-    // if (temp != "") {
-  // sma_bars = Database::Queue{50};
-  update_bars(ticker);
-      // sma_bars[temp] = Database::Queue{50};
-      // update_bars(temp);
-    // }
-  // }
-}
-
-mongocxx::cursor Database::query_database(string collection_name, vector<QueryBase*> query)
-{
-  vector<bsoncxx::document::view> documents;
-  mongocxx::collection collection = database_[collection_name];
-  bsoncxx::builder::basic::document doc = document{};
-  for (unsigned int i = 0; i < query.size(); i++)
-  {
-    QueryBase* _query = query[i];
-    unsigned int type = _query->query_type;
-    switch (type) {
-      case 0:
-        parse_query<unsigned short>(_query, &doc);
-        break;
-      case 1:
-        parse_query<int>(_query, &doc);
-        break;
-      case 2:
-        parse_query<double>(_query, &doc);
-        break;
+mongocxx::instance& mongo_instance() {
+  static mongocxx::instance instance;
+  return instance;
+}
+
+Database::Database() : Database(load_tickers(getenv("TICKER_PATH") ? getenv("TICKER_PATH") : "tickers")) {}
+
+Database::Database(vector<string> tickers_, bool connect) : quotes(tickers_) {
+  tickers = tickers_;
+  for (const string& ticker : tickers) {
+    sma_bars.emplace(ticker, Queue(BAR_WINDOW));
+    indicators.emplace(ticker, Indicators());
+    builders.emplace(ticker, BarBuilder(ticker));
+    sessions.emplace(ticker, Session());
+  }
+  if (!connect) return;
+
+  mongo_instance();
+  pool_.reset(new mongocxx::pool(mongocxx::uri{getenv("MONGO_DB_URI")}));
+  database_name_ = getenv("MONGO_DB_DATABASE");
+
+  // the maps are fully populated above, so each worker only touches its own tickers
+  unsigned int workers = thread::hardware_concurrency();
+  if (workers == 0) workers = 4;
+  if (workers > tickers.size()) workers = tickers.size();
+  vector<thread> threads;
+  for (unsigned int i = 0; i < workers; i++) {
+    threads.emplace_back([this, i, workers]() {
+      for (unsigned int j = i; j < tickers.size(); j += workers) {
+        ensure_index(tickers[j]);
+        update_bars(tickers[j]);
+      }
+    });
+  }
+  for (thread& worker : threads) worker.join();
+}
+
+Tick to_tick(string ticker, bsoncxx::document::view document) {
+  Tick tick;
+  bsoncxx::document::element key = document["key"];
+  if (key && key.type() == bsoncxx::type::k_utf8) tick.ticker = string(key.get_utf8().value);
+  else tick.ticker = ticker;
+  tick.last_price = get_number(document["LAST_PRICE"]);
+  tick.last_size = get_number(document["LAST_SIZE"]);
+  tick.total_volume = get_number(document["TOTAL_VOLUME"]);
+  tick.bid_price = get_number(document["BID_PRICE"]);
+  tick.ask_price = get_number(document["ASK_PRICE"]);
+  tick.bid_size = get_number(document["BID_SIZE"]);
+  tick.ask_size = get_number(document["ASK_SIZE"]);
+  tick.hour = (unsigned short) get_number(document["HOUR"]);
+  tick.minute = (unsigned short) get_number(document["MINUTE"]);
+  tick.second = (unsigned short) get_number(document["SECOND"]);
+  tick.time = ((int64_t) (tick.hour * 60 + tick.minute) * 60 + tick.second) * 1000000000LL;
+  return tick;
+}
+
+double trade_size(const Tick& tick, double& total_volume) {
+  double size = tick.last_size;
+  if (size == 0 && tick.total_volume > total_volume && total_volume > 0) size = tick.total_volume - total_volume;
+  if (tick.total_volume > total_volume) total_volume = tick.total_volume;
+  return size;
+}
+
+Database::~Database() {
+  stop_watching();
+}
+
+// true if `key` starts with HOUR, MINUTE, SECOND ascending, which serves every minute lookup
+static bool is_tick_index(bsoncxx::document::view key) {
+  const char* fields[] = {"HOUR", "MINUTE", "SECOND"};
+  unsigned int i = 0;
+  for (bsoncxx::document::element field : key) {
+    if (i == 3) break;
+    if (field.key() != fields[i] || get_number(field) <= 0) return false;
+    i++;
+  }
+  return i == 3;
+}
+
+bool Database::ensure_index(string ticker) {
+  mongocxx::pool::entry client = pool_->acquire();
+  mongocxx::collection collection = (*client)[database_name_][ticker];
+  try {
+    mongocxx::cursor indexes = collection.list_indexes();
+    for (mongocxx::cursor::iterator iter = indexes.begin(); iter != indexes.end(); iter++) {
+      bsoncxx::document::element key = (*iter)["key"];
+      if (key && key.type() == bsoncxx::type::k_document && is_tick_index(key.get_document().value)) {
+        cout << "Index on " << ticker << ": present" << endl;
+        return true;
+      }
     }
+
+    // creating the index also creates the collection if the stream hasn't written to it yet
+    collection.create_index(make_document(kvp("HOUR", 1), kvp("MINUTE", 1), kvp("SECOND", 1)));
+    cout << "Index on " << ticker << ": created " << TICK_INDEX << endl;
+    return true;
+  }
+  catch (const mongocxx::operation_exception& e) {
+    cerr << "Index on " << ticker << ": failed to build " << TICK_INDEX << ": " << e.what() << endl;
+    return false;
   }
+}
 
-  mongocxx::cursor cursor = collection.find(
-      doc.extract()
-  );
+bool Database::ensure_indexes() {
+  bool ok = true;
+  for (const string& ticker : tickers) ok = ensure_index(ticker) && ok;
+  return ok;
+}
+
+vector<string> Database::load_tickers(string path) {
+  vector<string> tickers;
+  ifstream tickerFile(path);
+  string temp;
+  while (getline(tickerFile, temp)) {
+    if (temp != "") tickers.push_back(temp);
+  }
+  return tickers;
+}
 
-  return cursor;
+void Database::update_bars()
+{
+  for (const string& ticker : tickers) update_bars(ticker);
 }
 
 void Database::update_bars(string ticker)
 {
-  if (sma_bars.size < sma_bars.max_size)
+  Queue& window = sma_bars.at(ticker);
+  Indicators& state = indicators.at(ticker);
+  Time now;
+  if (window.size < window.max_size)
   {
-    Time timeObj;
-    timeObj--;
-    Bar* temp = get_bar(ticker, timeObj._time[0], timeObj._time[1]);
-    unsigned short counter = sma_bars.size;
-    while (temp != NULL && counter < sma_bars.max_size)
-    {
-      sma_bars.enqueueHead(temp);
-      timeObj--;
-      temp = get_bar(ticker, timeObj._time[0], timeObj._time[1]);
-      counter++;
+    Time start = now;
+    for (unsigned short i = 1; i < window.max_size; i++) start--;
+    vector<Bar> bars = get_bars(ticker, start._time[0], now._time[0], start._time[1], now._time[1]);
+
+    lock_guard<mutex> lock(mutex_);
+    Session& session = sessions.at(ticker);
+    // until the window fills every call reloads it whole, so the session is rebuilt from it too
+    session = Session{0, 0, 0, session.total_volume};
+    window.clear();
+    for (const Bar& bar : bars) {
+      window.enqueue(bar);
+      session.add(bar);
     }
+    state.reset(window);
+    window.last_hour = now._time[0];
+    window.last_min = now._time[1];
+    // carry the minutes already traded in the current 5m and 15m buckets into the live bars
+    BarBuilder& builder = builders.at(ticker);
+    if (builder.frames[0].start < 0)
+      builder.seed(bars, BarBuilder::level(MINUTE_1), (now._time[0] * 60 + now._time[1]) * 60);
   }
   else
   {
-    Time timeObj;
-    if (timeObj._time[0] == sma_bars.last_hour && timeObj._time[1] == sma_bars.last_min) {
-      Queue::Node* temp = (sma_bars.tail)->prev;
-      Queue::Node* newTail = new Queue::Node(temp, get_bar(ticker, sma_bars.last_hour, sma_bars.last_min));
-      delete sma_bars.tail;
-      temp->next = newTail;
-      sma_bars.tail = newTail;
+    Bar bar;
+    if (!get_bar(ticker, now._time[0], now._time[1], bar)) return;
+
+    lock_guard<mutex> lock(mutex_);
+    Session& session = sessions.at(ticker);
+    session.add(bar);
+    if (now._time[0] == window.last_hour && now._time[1] == window.last_min) {
+      double close = window.back().close;
+      session.remove(window.back());
+      window.back() = bar;
+      state.revise(close, bar.close);
     }
     else
     {
-        Bar* remove = sma_bars.dequeue();
-        delete remove;
-        Bar* _new = get_bar(ticker, timeObj._time[0], timeObj._time[1]);
-        if (_new == NULL) return;
-        sma_bars.enqueue(_new);
-        sma_bars.last_hour = timeObj._time[0];
-        sma_bars.last_min = timeObj._time[1];
+        state.push(window, bar);
+        window.enqueue(bar);
+        window.last_hour = now._time[0];
+        window.last_min = now._time[1];
     }
   }
+  notify();
 }
 
-Bar* Database::get_bar(string ticker, unsigned short hour, unsigned short minute) {
-  vector<QueryBase*> query;
-  Query<unsigned short>* hour_query = new Query<unsigned short>("HOUR", hour);
-  Query<unsigned short>* minute_query = new Query<unsigned short>("MINUTE", minute);
-  query.push_back(hour_query);
-  query.push_back(minute_query);
-  mongocxx::cursor result = query_database(ticker, query);
+// LAST_PRICE and LAST_SIZE come through as either doubles or ints depending on the tick
+double get_number(bsoncxx::document::element element) {
+  if (!element) return 0;
+  switch (element.type()) {
+    case bsoncxx::type::k_double:
+      return element.get_double().value;
+    case bsoncxx::type::k_int32:
+      return (double) element.get_int32().value;
+    case bsoncxx::type::k_int64:
+      return (double) element.get_int64().value;
+    default:
+      return 0;
+  }
+}
+
+bool Database::get_bar(string ticker, unsigned short hour, unsigned short minute, Bar& bar) {
+  if (aggregate) return aggregate_bar(ticker, hour, minute, bar);
+  return scan_bar(ticker, hour, minute, bar);
+}
+
+// the only tick fields the bar pipelines read. TICK_INDEX serves the $match, but the _id that
+// keeps ticks within a second in insertion order isn't in it, so the $sort is a blocking
+// in-memory sort of the matched ticks; projecting after it keeps the documents that sort and
+// $group hold down to these fields.
+static bsoncxx::document::value tick_projection() {
+  return make_document(kvp("HOUR", 1), kvp("MINUTE", 1), kvp("SECOND", 1), kvp("LAST_PRICE", 1), kvp("LAST_SIZE", 1),
+    kvp("TOTAL_VOLUME", 1));
+}
+
+// sets SIZE on every tick by the trade_size rule, carried across ticks with a window over the
+// ones before it; `before` is the total ahead of the first tick (needs MongoDB 5.0)
+static void append_trade_size(mongocxx::pipeline& pipeline, double before) {
+  using bsoncxx::builder::basic::make_array;
+  pipeline.append_stage(make_document(kvp("$setWindowFields", make_document(
+    kvp("sortBy", make_document(kvp("HOUR", 1), kvp("MINUTE", 1), kvp("SECOND", 1), kvp("_id", 1))),
+    kvp("output", make_document(kvp("PREVIOUS_VOLUME", make_document(
+      kvp("$max", "$TOTAL_VOLUME"),
+      kvp("window", make_document(kvp("documents", make_array("unbounded", -1))))
+    ))))
+  ))));
+  pipeline.append_stage(make_document(kvp("$set", make_document(
+    kvp("PREVIOUS_VOLUME", make_document(kvp("$max", make_array("$PREVIOUS_VOLUME", before))))
+  ))));
+  pipeline.append_stage(make_document(kvp("$set", make_document(kvp("SIZE", make_document(kvp("$cond", make_array(
+    make_document(kvp("$gt", make_array(make_document(kvp("$ifNull", make_array("$LAST_SIZE", 0))), 0))),
+    "$LAST_SIZE",
+    make_document(kvp("$cond", make_array(
+      make_document(kvp("$and", make_array(
+        make_document(kvp("$gt", make_array("$TOTAL_VOLUME", "$PREVIOUS_VOLUME"))),
+        make_document(kvp("$gt", make_array("$PREVIOUS_VOLUME", 0)))
+      ))),
+      make_document(kvp("$subtract", make_array("$TOTAL_VOLUME", "$PREVIOUS_VOLUME"))),
+      0
+    )))
+  ))))))));
+}
+
+// $group accumulators shared by the single bar and bar range pipelines
+static void append_ohlc(bsoncxx::builder::basic::document* group) {
+  group->append(
+    kvp("open", make_document(kvp("$first", "$LAST_PRICE"))),
+    kvp("close", make_document(kvp("$last", "$LAST_PRICE"))),
+    kvp("low", make_document(kvp("$min", "$LAST_PRICE"))),
+    kvp("high", make_document(kvp("$max", "$LAST_PRICE"))),
+    kvp("volume", make_document(kvp("$sum", "$SIZE"))),
+    kvp("notional", make_document(kvp("$sum", make_document(kvp("$multiply", bsoncxx::builder::basic::make_array("$LAST_PRICE", "$SIZE")))))),
+    kvp("ticks", make_document(kvp("$sum", 1)))
+  );
+}
+
+bool to_bar(string ticker, unsigned short hour, unsigned short minute, bsoncxx::document::view document, Bar& bar) {
+  if (!document["low"] || document["low"].type() == bsoncxx::type::k_null) return false;
+  bar = Bar(ticker, hour, minute, get_number(document["open"]), get_number(document["close"]),
+    get_number(document["low"]), get_number(document["high"]), get_number(document["volume"]));
+  bar.notional = get_number(document["notional"]);
+  bar.ticks = (unsigned int) get_number(document["ticks"]);
+  return true;
+}
+
+double Database::volume_before(mongocxx::client& client, string ticker, unsigned short hour, unsigned short minute) {
+  // TOTAL_VOLUME only grows through the day, so the last trade before the minute has the running total
+  mongocxx::cursor result = query_database(client, ticker,
+    query::any_of(query::filter(query::lt("HOUR", hour)), query::filter(query::eq("HOUR", hour), query::lt("MINUTE", minute))),
+    query::gt("LAST_PRICE", 0), query::gt("TOTAL_VOLUME", 0),
+    query::sort("HOUR", -1), query::sort("MINUTE", -1), query::sort("SECOND", -1),
+    query::project("TOTAL_VOLUME"), query::exclude("_id"), query::limit(1));
+  for (mongocxx::cursor::iterator iter = result.begin(); iter != result.end(); iter++) return get_number((*iter)["TOTAL_VOLUME"]);
+  return 0;
+}
+
+bool Database::aggregate_bar(string ticker, unsigned short hour, unsigned short minute, Bar& bar) {
+  mongocxx::pool::entry client = pool_->acquire();
+  // quote only updates carry no trade, on_tick skips them too
+  mongocxx::pipeline pipeline;
+  pipeline.match(query::filter(query::eq("HOUR", hour), query::eq("MINUTE", minute), query::gt("LAST_PRICE", 0)));
+  pipeline.sort(make_document(kvp("SECOND", 1), kvp("_id", 1)));
+  pipeline.project(tick_projection());
+  append_trade_size(pipeline, volume_before(*client, ticker, hour, minute));
+  bsoncxx::builder::basic::document group = document{};
+  group.append(kvp("_id", bsoncxx::types::b_null{}));
+  append_ohlc(&group);
+  pipeline.group(group.extract());
+
+  mongocxx::cursor result = (*client)[database_name_][ticker].aggregate(pipeline);
+  mongocxx::cursor::iterator iter = result.begin();
+  if (iter == result.end()) return false;
+  return to_bar(ticker, hour, minute, *iter, bar);
+}
+
+bool Database::scan_bar(string ticker, unsigned short hour, unsigned short minute, Bar& bar) {
+  mongocxx::pool::entry client = pool_->acquire();
+  double total_volume = volume_before(*client, ticker, hour, minute);
+  mongocxx::cursor result = query_database(*client, ticker, query::eq("HOUR", hour), query::eq("MINUTE", minute),
+    query::gt("LAST_PRICE", 0), query::sort("SECOND", 1), query::sort("_id", 1),
+    query::project("LAST_PRICE", "LAST_SIZE", "TOTAL_VOLUME"), query::exclude("_id"));
 
   double min = numeric_limits<double>::max();
-  double max = numeric_limits<double>::min();
+  double max = numeric_limits<double>::lowest();
   double open, close;
   double temp = 0;
+  double volume = 0, notional = 0;
+  unsigned int ticks = 0;
   bool first = 1;
   for (mongocxx::cursor::iterator iter = result.begin(); iter != result.end(); iter++) {
-    double last_price = 0;
-    try {
-      last_price = (*iter)["LAST_PRICE"].get_double().value;
-    }
-    catch (...) {
-      last_price = (double) (*iter)["LAST_PRICE"].get_int32().value;
-    }
+    double last_price = get_number((*iter)["LAST_PRICE"]);
     if (first) {
       first = !first;
       open = last_price;
@@ -118,61 +313,100 @@ Bar* Database::get_bar(string ticker, unsigned short hour, unsigned short minute
     if (last_price < min) min = last_price;
     if (last_price > max) max = last_price;
     temp = last_price;
+    Tick tick;
+    tick.last_size = get_number((*iter)["LAST_SIZE"]);
+    tick.total_volume = get_number((*iter)["TOTAL_VOLUME"]);
+    double last_size = trade_size(tick, total_volume);
+    volume += last_size;
+    notional += last_price * last_size;
+    ticks++;
   }
   close = temp;
-  if (!(min == numeric_limits<double>::max() || max == numeric_limits<double>::min()))
-    return new Bar(ticker, hour, minute, open, close, min, max);
-  else return NULL;
+  if (first) return false;
+  bar = Bar(ticker, hour, minute, open, close, min, max, volume);
+  bar.notional = notional;
+  bar.ticks = ticks;
+  return true;
 }
 
-vector<Bar*> Database::get_bars(string ticker, unsigned short hour_start, unsigned short hour_end, unsigned short minute_start, unsigned short minute_end)
+vector<Bar> Database::get_bars(string ticker, unsigned short hour_start, unsigned short hour_end, unsigned short minute_start, unsigned short minute_end)
 {
-  vector<Bar*> bars;
-  unsigned short hour = hour_start;
-  for (unsigned short i = minute_start; i <= ((hour_end - hour_start) * 60) + minute_end; i++) {
-    if (i != minute_start && i % 60 == 0) hour++;
-    Bar* bar = get_bar(ticker, hour, i % 60);
-    if (bar != NULL) bars.push_back(bar);
+  vector<Bar> bars;
+  Bar bar;
+  if (hour_start * 60 + minute_start > hour_end * 60 + minute_end) return bars;
+  if (!aggregate) {
+    Time time(hour_start, minute_start);
+    Time end(hour_end, minute_end);
+    end++;
+    for (; time != end; time++) {
+      if (scan_bar(ticker, time._time[0], time._time[1], bar)) bars.push_back(bar);
+    }
+    return bars;
+  }
+
+  // every minute in [start, end] in one pass, grouped into bars on the server
+  mongocxx::pipeline pipeline;
+  if (hour_start == hour_end)
+    pipeline.match(query::filter(query::eq("HOUR", hour_start), query::range("MINUTE", minute_start, minute_end),
+      query::gt("LAST_PRICE", 0)));
+  else
+    pipeline.match(query::filter(query::any_of(
+      query::filter(query::eq("HOUR", hour_start), query::gte("MINUTE", minute_start)),
+      query::filter(query::range("HOUR", hour_start, hour_end, false)),
+      query::filter(query::eq("HOUR", hour_end), query::lte("MINUTE", minute_end))
+    ), query::gt("LAST_PRICE", 0)));
+  pipeline.sort(make_document(kvp("HOUR", 1), kvp("MINUTE", 1), kvp("SECOND", 1), kvp("_id", 1)));
+  pipeline.project(tick_projection());
+  mongocxx::pool::entry client = pool_->acquire();
+  append_trade_size(pipeline, volume_before(*client, ticker, hour_start, minute_start));
+  bsoncxx::builder::basic::document group = document{};
+  group.append(kvp("_id", make_document(kvp("HOUR", "$HOUR"), kvp("MINUTE", "$MINUTE"))));
+  append_ohlc(&group);
+  pipeline.group(group.extract());
+  pipeline.sort(make_document(kvp("_id.HOUR", 1), kvp("_id.MINUTE", 1)));
+
+  mongocxx::cursor result = (*client)[database_name_][ticker].aggregate(pipeline);
+  for (mongocxx::cursor::iterator iter = result.begin(); iter != result.end(); iter++) {
+    bsoncxx::document::view id = (*iter)["_id"].get_document().value;
+    if (to_bar(ticker, (unsigned short) get_number(id["HOUR"]), (unsigned short) get_number(id["MINUTE"]), *iter, bar))
+      bars.push_back(bar);
   }
   return bars;
 }
 
 double Database::get_sma(string ticker, unsigned short offset)
 {
-  double sum = 0;
-  update_bars(ticker);
-  if (offset > sma_bars.max_size || offset > sma_bars.size) return 0;
-  Database::Queue::iterator iter = sma_bars.begin_from_end();
-  for (unsigned short i = 0; i < offset; i++) {
-    Bar* bar = iter.value();
-    if (bar == NULL) {
-      return 0;
-    }
-    sum += bar->close;
-    iter--;
-  }
-  return sum / offset;
+  lock_guard<mutex> lock(mutex_);
+  Queue& window = sma_bars.at(ticker);
+  if (offset > window.max_size || offset > window.size) return 0;
+  return indicators.at(ticker).sma(offset, window);
 }
 
 double Database::get_ema(string ticker, unsigned short offset)
 {
-  if (offset > sma_bars.max_size || offset > sma_bars.size) return 0;
-  return get_ema(ticker, offset, offset, sma_bars.begin_from_end());
+  lock_guard<mutex> lock(mutex_);
+  Queue& window = sma_bars.at(ticker);
+  if (offset > window.max_size || offset > window.size) return 0;
+  return indicators.at(ticker).ema(offset, window);
+}
+
+Database::Indicators::Macd Database::get_macd(string ticker)
+{
+  lock_guard<mutex> lock(mutex_);
+  return indicators.at(ticker).macd;
 }
 
-double Database::get_ema(string ticker, unsigned short offset, unsigned short adjOffset, Database::Queue::iterator iter)
+double Database::get_vwap(string ticker)
 {
-  double price = iter.value()->close;
-  iter--;
-  return price * (2 / (offset + 1)) + get_ema(ticker, offset, --adjOffset, iter);
+  lock_guard<mutex> lock(mutex_);
+  return sessions.at(ticker).vwap();
 }
 
 Time::Time() {
-  time_t now = time(0);
-  tm* ltm = localtime(&now);
-  _time[0] = ltm->tm_hour;
-  _time[1] = ltm->tm_min;
-  _time[2] = ltm->tm_sec;
+  int64_t seconds = Clock::current()->now() / NANOS_PER_SECOND;
+  _time[0] = seconds / 3600;
+  _time[1] = (seconds / 60) % 60;
+  _time[2] = seconds % 60;
 }
 
 Time::Time(unsigned short hour, unsigned short minute) {
@@ -203,7 +437,7 @@ void Time::operator--(int value) {
   else _time[1] = _time[1] - 1;
 }
 
-Bar::Bar(string ticker_, unsigned short hour_, unsigned short minute_, double open_, double close_, double low_, double high_) {
+Bar::Bar(string ticker_, unsigned short hour_, unsigned short minute_, double open_, double close_, double low_, double high_, double volume_) {
   ticker = ticker_;
   hour = hour_;
   minute = minute_;
@@ -211,52 +445,36 @@ Bar::Bar(string ticker_, unsigned short hour_, unsigned short minute_, double op
   close = close_;
   low = low_;
   high = high_;
+  volume = volume_;
 }
 
-Database::Queue::Queue(unsigned short _max_size) {
+Database::Queue::Queue(unsigned short _max_size) : bars(_max_size) {
   max_size = _max_size;
 }
 
-Bar* Database::Queue::dequeue() {
-  Node* temp = head;
-  if (head->next == NULL) {
-    head = NULL;
-    return temp->value;
-  }
-  head->next->prev = NULL;
-  head = head->next;
+void Database::Queue::dequeue() {
+  if (size == 0) return;
+  head = head + 1 == max_size ? 0 : head + 1;
   size--;
-  return temp->value;
 }
 
-void Database::Queue::enqueueHead(Bar* _bar) {
+void Database::Queue::enqueueHead(const Bar& _bar) {
+  if (size == max_size) return;
+  head = head == 0 ? max_size - 1 : head - 1;
+  bars[head] = _bar;
   size++;
-  if (head == NULL && tail == NULL) {
-    head = new Node(_bar);
-    tail = head;
-    return;
-  }
-  Node* temp = new Node(_bar, head);
-  head->prev = temp;
-  temp->next = head;
-  head = temp;
 }
 
-void Database::Queue::enqueue(Bar* _bar) {
+void Database::Queue::enqueue(const Bar& _bar) {
+  if (max_size == 0) return;
+  if (size == max_size) dequeue();
   size++;
-  if (head == NULL && tail == NULL) {
-    head = new Node(_bar);
-    tail = head;
-    return;
-  }
-  Node* temp = new Node(tail, _bar);
-  tail->next = temp;
-  temp->prev = tail;
-  tail = temp;
+  (*this)[size - 1] = _bar;
 }
 
-Bar* Database::Queue::peek() {
-  return head->value;
+void Database::Queue::clear() {
+  head = 0;
+  size = 0;
 }
 
 bool Database::Queue::isEmpty() {
@@ -268,28 +486,28 @@ bool Database::Queue::isFull() {
 }
 
 Database::Queue::iterator Database::Queue::begin() {
-  return Database::Queue::iterator(head);
+  return Database::Queue::iterator(this, 0);
 }
 
 Database::Queue::iterator Database::Queue::begin_from_end() {
-  return Database::Queue::iterator(tail);
+  return Database::Queue::iterator(this, (int) size - 1);
 }
 
 Database::Queue::iterator Database::Queue::end() {
-  return Database::Queue::iterator(NULL);
+  return Database::Queue::iterator(this, size);
 }
 
 Bar* Database::Queue::iterator::value() {
-  if (node == NULL) return NULL;
-  return node->value;
+  if (index < 0 || index >= queue->size) return NULL;
+  return &(*queue)[index];
 }
 
 void Database::Queue::iterator::operator++(int value) {
-  node = node->next;
+  index++;
 }
 
 void Database::Queue::iterator::operator--(int value) {
-  node = node->prev;
+  index--;
 }
 
 bool Database::Queue::iterator::operator==(iterator second) {
@@ -7,8 +7,17 @@
 #include <unordered_map>
 #include <vector>
 #include <limits>
-
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <functional>
+
+#include <mongocxx/change_stream.hpp>
 #include <mongocxx/client.hpp>
+#include <mongocxx/pipeline.hpp>
+#include <mongocxx/pool.hpp>
 #include <mongocxx/stdx.hpp>
 #include <mongocxx/uri.hpp>
 #include <mongocxx/instance.hpp>
@@ -19,80 +28,116 @@
 #include <bsoncxx/document/value.hpp>
 #include <bsoncxx/types.hpp>
 
+#include "clock.h"
+#include "quotes.h"
+#include "query.h"
+
 using bsoncxx::builder::basic::document;
 using bsoncxx::builder::basic::kvp;
 using bsoncxx::builder::basic::make_document;
 
 using namespace std;
 
-// constants for database queries
-const string GREATER_THAN = "$gt";
-const string LESS_THAN = "$lt";
-const string GREATER_THAN_EQ = "$gte";
-const string LESS_THAN_EQ = "$lte";
-const string EQ = "$eq";
-
-template <typename T>
-unsigned int checkType(T check) {
-  if (typeid(check) == typeid(unsigned short)) return 0;
-  else if (typeid(check) == typeid(int)) return 1;
-  else if (typeid(check) == typeid(double)) return 2;
-}
+// number of one minute bars kept per ticker
+const unsigned short BAR_WINDOW = 64;
+
+// compound index every tick collection should have, named the way mongod names it by default
+const char* const TICK_INDEX = "HOUR_1_MINUTE_1_SECOND_1";
+
+// the driver allows one mongocxx::instance per process and it must outlive every client, so
+// everything that connects shares this one, created on first use
+mongocxx::instance& mongo_instance();
+
+// numeric BSON field as a double regardless of how it was stored, 0 if missing
+double get_number(bsoncxx::document::element element);
 
-struct QueryBase {
-  bool eq;
-  string key;
-  unsigned int query_type, constructor_type;
-  const string _operator;
-  template <typename T> T getValue();
-  template <typename T> T getLow();
-  template <typename T> T getHigh();
-  QueryBase(string key_) : key(key_) {}
-  QueryBase(string key_, const string operator_) : key(key_), _operator(operator_) {}
-  QueryBase(string key_, bool eq_) : key(key_), eq(eq_) {}
-  virtual ~QueryBase() = default;
+struct Bar {
+  string ticker;
+  double open = 0, close = 0, low = 0, high = 0, volume = 0;
+  // sum of price * size over the bar's trades, and how many trades there were
+  double notional = 0;
+  unsigned int ticks = 0;
+  unsigned short hour = 0, minute = 0, second = 0;
+  // length of the bar in seconds
+  unsigned int timeframe = 60;
+  Bar() {}
+  Bar(string ticker, unsigned short hour, unsigned short minute, double open, double close, double low, double high, double volume = 0);
+
+  double vwap() const { return volume > 0 ? notional / volume : close; }
 };
 
-template <typename T>
-struct Query : public QueryBase {
-  T value, low, high;
-  T getValue() { return value; }
-  T getLow() { return low; }
-  T getHigh() { return high; }
-  Query(string key_, T value_) : QueryBase(key_), value(value_) {
-    query_type = checkType<T>(value_);
-    constructor_type = 0;
-  }
-  Query(string key_, const string operator_, T value_) : QueryBase(key_, operator_), value(value_) {
-    query_type = checkType<T>(value_);
-    constructor_type = 1;
-  }
-  Query(string key_, T low_, T high_, bool eq_) : QueryBase(key_, eq_), low(low_), high(high_) {
-    query_type = checkType<T>(low_);
-    unsigned int temp = checkType<T>(high_);
-    if (temp > query_type) query_type = temp;
-    constructor_type = 2;
-  }
+// one level one quote as written by the stream script
+struct Tick {
+  string ticker;
+  double last_price = 0, last_size = 0;
+  // cumulative session volume reported by the feed
+  double total_volume = 0;
+  // 0 when the quote update didn't carry the field
+  double bid_price = 0, ask_price = 0, bid_size = 0, ask_size = 0;
+  unsigned short hour = 0, minute = 0, second = 0;
+  // nanoseconds since midnight exchange time
+  int64_t time = 0;
 };
 
-struct Bar {
+// Size of the trade a tick reports. Level one updates only carry the fields that changed, so a
+// trade the same size as the last one has no LAST_SIZE; the move in TOTAL_VOLUME past the
+// running total (`total_volume`, which this advances) still gives its size. Every path that
+// turns ticks into volume goes through this rule: on_tick, the archive and both Mongo bar paths.
+double trade_size(const Tick& tick, double& total_volume);
+
+// bar resolutions in seconds, finest first, each one divides the next
+enum Timeframe {
+  SECOND_1 = 1,
+  SECOND_5 = 5,
+  MINUTE_1 = 60,
+  MINUTE_5 = 300,
+  MINUTE_15 = 900,
+};
+const unsigned int TIMEFRAME_COUNT = 5;
+const Timeframe TIMEFRAMES[TIMEFRAME_COUNT] = {SECOND_1, SECOND_5, MINUTE_1, MINUTE_5, MINUTE_15};
+
+// Builds every timeframe for one symbol from a single pass over its ticks. Only the finest bar
+// takes ticks; when it closes it is rolled into the next coarser bar, and so on up the chain, so
+// coarser bars never rescan ticks. The live view of a coarser bar is its rolled up part merged
+// with the live finer bars below it.
+struct BarBuilder {
+  struct Frame {
+    Bar bar;
+    // seconds since midnight the bar started at, -1 before the first tick
+    int start = -1;
+    bool empty = true;
+  };
+
   string ticker;
-  double open, close, low, high;
-  unsigned short hour, minute;
-  Bar(string ticker, unsigned short hour, unsigned short minute, double open, double close, double low, double high);
+  Frame frames[TIMEFRAME_COUNT];
+  // bars closed by the last tick, bit i set for TIMEFRAMES[i]
+  unsigned int closed_mask = 0;
+  Bar closed[TIMEFRAME_COUNT];
+
+  // false for a tick older than the live one second bar, which is dropped
+  bool on_tick(double price, double size, unsigned int seconds);
+  // start every frame at `seconds` from TIMEFRAMES[level] bars built elsewhere (oldest first),
+  // e.g. the warm-up minutes, each coarser frame taking the finished ones in its bucket
+  void seed(const vector<Bar>& bars, unsigned int level, unsigned int seconds);
+  // live bar for TIMEFRAMES[level], false if nothing has traded in it yet
+  bool current(unsigned int level, Bar& bar);
+  static unsigned int level(Timeframe timeframe);
+
+  BarBuilder(string _ticker = "") : ticker(_ticker) {}
 };
 
+struct Archive;
+struct Columns;
+
+// bar from one document produced by the get_bar/get_bars $group stage
+bool to_bar(string ticker, unsigned short hour, unsigned short minute, bsoncxx::document::view document, Bar& bar);
+
+// tick from a document in one of the ticker collections, `ticker` is used if it has no key
+Tick to_tick(string ticker, bsoncxx::document::view document);
+
 struct Database {
+  // fixed-capacity ring of bars stored by value, oldest at head
   struct Queue {
-    struct Node {
-      Node* prev;
-      Node* next;
-      Bar* value;
-      Node(Node* _prev, Bar* _value) : prev(_prev), value(_value) {}
-      Node(Bar* _value, Node* _next) : value(_value), next(_next) {}
-      Node(Bar* _value) : value(_value) {}
-      Node() {}
-    };
     struct iterator {
       void operator++(int);
       void operator--(int);
@@ -101,26 +146,37 @@ struct Database {
 
       Bar* value();
 
-      iterator(Node* _node) : node(_node) {}
+      iterator(Queue* _queue, int _index) : queue(_queue), index(_index) {}
 
       private:
-        Node* node;
+        Queue* queue;
+        int index;
     };
 
-    Node* head = nullptr;
-    Node* tail = nullptr;
-    unsigned short max_size;
+    vector<Bar> bars;
+    unsigned short head = 0;
+    unsigned short max_size = 0;
     unsigned short size = 0;
     unsigned short last_min = 0;
     unsigned short last_hour = 0;
 
-    Bar* dequeue();
-    void enqueueHead(Bar* _bar);
-    void enqueue(Bar* _bar);
-    Bar* peek();
+    void dequeue();
+    void enqueueHead(const Bar& _bar);
+    void enqueue(const Bar& _bar);
+    void clear();
+    Bar& peek() { return bars[head]; }
+    Bar& back() { return at(0); }
     bool isEmpty();
     bool isFull();
 
+    // i-th oldest bar, no bounds checking
+    Bar& operator[](unsigned short i) {
+      unsigned int index = head + i;
+      return bars[index < max_size ? index : index - max_size];
+    }
+    // bar closed `age` minutes before the newest one
+    Bar& at(unsigned short age) { return (*this)[size - 1 - age]; }
+
     iterator begin();
     iterator begin_from_end();
     iterator end();
@@ -129,29 +185,177 @@ struct Database {
     Queue() {}
   };
 
-  mongocxx::instance instance_ = mongocxx::instance{};
-  mongocxx::client client_;
-  mongocxx::database database_;
+  // running indicator state, updated in O(1) as bars close or are revised
+  struct Indicators {
+    struct Sma {
+      unsigned short period;
+      unsigned short count = 0;
+      double sum = 0;
+
+      double value() { return count == period ? sum / period : 0; }
+
+      Sma(unsigned short _period) : period(_period) {}
+    };
+
+    // seeded with the simple average of the first `period` values
+    struct Ema {
+      unsigned short period;
+      double alpha;
+      unsigned int count = 0;
+      double sum = 0;
+      double previous = 0;
+      double value = 0;
+
+      void push(double close);
+      void revise(double old_close, double close);
+      bool ready() { return count >= period; }
+
+      Ema(unsigned short _period) : period(_period), alpha(2.0 / (_period + 1)) {}
+    };
+
+    struct Macd {
+      Ema fast{12};
+      Ema slow{26};
+      Ema signal{9};
+      double line = 0;
+      double histogram = 0;
+
+      void push(double close);
+      void revise(double old_close, double close);
+    };
+
+    vector<Sma> smas;
+    vector<Ema> emas;
+    Macd macd;
+
+    // call before the bar is enqueued so the close leaving each window is still there
+    void push(Queue& window, const Bar& bar);
+    void revise(double old_close, double close);
+    // rebuild every tracked indicator from scratch after the window is reloaded
+    void reset(Queue& window);
+
+    // tracked periods are registered on first use from the current window
+    double sma(unsigned short period, Queue& window);
+    double ema(unsigned short period, Queue& window);
+  };
+
+  // null for an offline Database that is only fed ticks through on_tick
+  unique_ptr<mongocxx::pool> pool_;
+  string database_name_;
+
+  vector<string> tickers;
+  unordered_map<string, Queue> sma_bars;
+  unordered_map<string, Indicators> indicators;
+  unordered_map<string, BarBuilder> builders;
+
+  // running totals for the trading day, fed by on_tick (or by update_bars when polling) and
+  // cleared by roll_day
+  struct Session {
+    double volume = 0;
+    double notional = 0;
+    unsigned long ticks = 0;
+    // last TOTAL_VOLUME seen
+    double total_volume = 0;
+
+    double vwap() const { return volume > 0 ? notional / volume : 0; }
+    void add(const Bar& bar) { volume += bar.volume; notional += bar.notional; ticks += bar.ticks; }
+    // take back a bar that update_bars is about to replace with a newer copy
+    void remove(const Bar& bar) { volume -= bar.volume; notional -= bar.notional; ticks -= bar.ticks; }
+  };
+  unordered_map<string, Session> sessions;
+  // top of book from the same ticks, readable from any thread without locking
+  QuoteBook quotes;
+
+  // build bars with a $group pipeline on the server instead of pulling every tick
+  bool aggregate = true;
 
-  // unordered_map<string, Queue> sma_bars;
-  Queue sma_bars{64};
+  // set while the change stream thread is feeding ticks into the windows
+  atomic<bool> watching{false};
 
-  Bar* get_bar(string ticker, unsigned short hour, unsigned short minute);
-  vector<Bar*> get_bars(string ticker, unsigned short hour_start, unsigned short hour_end, unsigned short minute_start, unsigned short minute_end);
+  bool get_bar(string ticker, unsigned short hour, unsigned short minute, Bar& bar);
+  // all bars in [start, end] from a single aggregation, oldest first
+  vector<Bar> get_bars(string ticker, unsigned short hour_start, unsigned short hour_end, unsigned short minute_start, unsigned short minute_end);
 
+  // indicator reads are precomputed, call update_bars to pull the latest bar first
   double get_sma(string ticker, unsigned short offset);
   double get_ema(string ticker, unsigned short offset);
 
-  double get_macd(string ticker);
+  Indicators::Macd get_macd(string ticker);
+  // intraday VWAP since the last roll_day over the bars loaded at startup and every trade after
+  // them, whether they came through on_tick or update_bars; 0 before the first
+  double get_vwap(string ticker);
 
   void update_bars(string ticker);
-
-  mongocxx::cursor query_database(string collection_name, vector<QueryBase*> query);
-
-  Database(string ticker);
+  // refresh every tracked ticker
+  void update_bars();
+
+  // folds a tick into the newest bar of its window, or opens the next minute
+  bool on_tick(const Tick& tick);
+  // called from the tick thread, after the windows are updated, with every live bar of
+  // `timeframe` for the ticker and once more with `closed` set when one finishes
+  void subscribe(Timeframe timeframe, function<void(const Bar& bar, bool closed)> callback);
+  // live bar of any timeframe, false if it has no ticks yet
+  bool get_current_bar(string ticker, Timeframe timeframe, Bar& bar);
+  // let the next day's ticks open new bars after the previous day's close, keeping the lookback.
+  // on_tick does this itself when the first tick of a new local date is earlier than the last one
+  void roll_day();
+  // subscribe to inserts on the tick collections and build bars from them in the background,
+  // false if the server can't open a change stream (standalone mongod)
+  bool watch();
+  // follow the ingester's shared memory tick ring (tick_ring.h) instead of the change stream,
+  // busy polling for the lowest latency; false if no producer has created it
+  bool follow(string ring);
+  void stop_watching();
+  // blocks until a bar changes after `version`, returns the new version
+  unsigned long wait_for_update(unsigned long version);
+
+  // find with typed clauses from query.h, the cursor borrows `client` so keep the pool entry
+  // alive while iterating it
+  template <typename... Clauses>
+  mongocxx::cursor query_database(mongocxx::client& client, string collection_name, const Clauses&... clauses);
+
+  // copy the ticker's collection into its columnar archive file for `date` (see archive.h),
+  // run it after the close and before the stream script drops the collections
+  bool archive_day(string ticker, uint32_t date);
+  // mmap a day's archive, bars and ticks are then read without touching Mongo
+  Archive open_archive(string ticker, uint32_t date);
+  // copy every ticker's bar window into structure-of-arrays columns for the batched
+  // kernels in columns.h, one symbol per tracked ticker in `tickers` order
+  Columns load_columns();
+
+  // create TICK_INDEX on the ticker's collection if it isn't there yet, false if the build failed
+  bool ensure_index(string ticker);
+  bool ensure_indexes();
+
+  static vector<string> load_tickers(string path);
+
+  // follows every ticker listed in TICKER_PATH
+  Database();
+  // connect = false skips Mongo entirely, for replaying archived ticks
+  Database(vector<string> tickers, bool connect = true);
+  ~Database();
 
   private:
-    double get_ema(string ticker, unsigned short offset, unsigned short adjOffset, Database::Queue::iterator iter);
+    // guards the windows and indicators between the watcher and strategy threads
+    mutex mutex_;
+    condition_variable updated_;
+    unsigned long version_ = 0;
+    thread watcher_;
+    // local date the windows were last rolled for, see on_tick
+    int day_ = local_day();
+    // copied on write by subscribe, so on_tick can keep calling the list it took under the lock
+    // after releasing it while another thread subscribes
+    shared_ptr<const vector<pair<Timeframe, function<void(const Bar&, bool)>>>> subscribers_ =
+      make_shared<const vector<pair<Timeframe, function<void(const Bar&, bool)>>>>();
+
+    void notify();
+    // roll_day with mutex_ already held
+    void reset_day();
+    static int local_day();
+    bool aggregate_bar(string ticker, unsigned short hour, unsigned short minute, Bar& bar);
+    bool scan_bar(string ticker, unsigned short hour, unsigned short minute, Bar& bar);
+    // TOTAL_VOLUME as it stood before hour:minute, where trade_size starts from for a bar
+    double volume_before(mongocxx::client& client, string ticker, unsigned short hour, unsigned short minute);
 };
 
 struct Time {
@@ -165,39 +369,12 @@ struct Time {
   Time(unsigned short hour, unsigned short minute, unsigned short second);
 };
 
-template <typename T>
-T QueryBase::getValue() {
-    return (dynamic_cast<Query<T>&>(*this)).getValue();
-  }
-
-template <typename T>
-T QueryBase::getLow() {
-  return (dynamic_cast<Query<T>&>(*this)).getLow();
-}
-
-template <typename T>
-T QueryBase::getHigh() {
-  return (dynamic_cast<Query<T>&>(*this)).getHigh();
-}
-
-template <typename T>
-void parse_query(QueryBase* query, bsoncxx::builder::basic::document* doc) {
-  switch (query->constructor_type) {
-    case 0:
-        doc->append(kvp(query->key, static_cast<T>(query->getValue<T>())));
-        break;
-    case 1:
-      doc->append(kvp(query->key, make_document(kvp(query->_operator, static_cast<T>(query->getValue<T>())))));
-      break;
-    case 2:
-      doc->append(kvp(query->key,
-        [query](bsoncxx::builder::basic::sub_document subdoc) {
-          if (query->eq) subdoc.append(kvp(GREATER_THAN_EQ, static_cast<T>(query->getLow<T>())), kvp(LESS_THAN_EQ, static_cast<T>(query->getHigh<T>())));
-          else subdoc.append(kvp(GREATER_THAN, static_cast<T>(query->getLow<T>())), kvp(LESS_THAN, static_cast<T>(query->getHigh<T>())));
-        }
-      ));
-      break;
-  }
+template <typename... Clauses>
+mongocxx::cursor Database::query_database(mongocxx::client& client, string collection_name, const Clauses&... clauses)
+{
+  mongocxx::options::find options;
+  bsoncxx::document::value filter = query::build(options, clauses...);
+  return client[database_name_][collection_name].find(filter.view(), options);
 }
 
 #endif // DATABASE_H_
@@ -0,0 +1,101 @@
+#include "database.h"
+
+void Database::Indicators::Ema::push(double close) {
+  count++;
+  previous = value;
+  if (count <= period) {
+    sum += close;
+    value = sum / count;
+  }
+  else value = alpha * close + (1 - alpha) * previous;
+}
+
+void Database::Indicators::Ema::revise(double old_close, double close) {
+  if (count == 0) return;
+  if (count <= period) {
+    sum += close - old_close;
+    value = sum / count;
+  }
+  else value = alpha * close + (1 - alpha) * previous;
+}
+
+void Database::Indicators::Macd::push(double close) {
+  fast.push(close);
+  slow.push(close);
+  line = fast.value - slow.value;
+  // until the slow EMA has its full period the line is a short SMA difference, keep it out of the signal
+  if (!slow.ready()) return;
+  signal.push(line);
+  histogram = line - signal.value;
+}
+
+void Database::Indicators::Macd::revise(double old_close, double close) {
+  double old_line = line;
+  fast.revise(old_close, close);
+  slow.revise(old_close, close);
+  line = fast.value - slow.value;
+  // revising the newest bar, so slow was ready when push fed its line to the signal
+  if (!slow.ready()) return;
+  signal.revise(old_line, line);
+  histogram = line - signal.value;
+}
+
+void Database::Indicators::push(Queue& window, const Bar& bar) {
+  for (Sma& sma : smas) {
+    if (sma.count < sma.period) {
+      sma.count++;
+      sma.sum += bar.close;
+    }
+    else sma.sum += bar.close - window.at(sma.period - 1).close;
+  }
+  for (Ema& ema : emas) ema.push(bar.close);
+  macd.push(bar.close);
+}
+
+void Database::Indicators::revise(double old_close, double close) {
+  for (Sma& sma : smas) {
+    if (sma.count > 0) sma.sum += close - old_close;
+  }
+  for (Ema& ema : emas) ema.revise(old_close, close);
+  macd.revise(old_close, close);
+}
+
+void Database::Indicators::reset(Queue& window) {
+  for (Sma& sma : smas) {
+    sma.count = 0;
+    sma.sum = 0;
+    for (unsigned short i = 0; i < sma.period && i < window.size; i++) {
+      sma.count++;
+      sma.sum += window.at(i).close;
+    }
+  }
+  for (Ema& ema : emas) {
+    ema = Ema(ema.period);
+    for (unsigned short i = 0; i < window.size; i++) ema.push(window[i].close);
+  }
+  macd = Macd();
+  for (unsigned short i = 0; i < window.size; i++) macd.push(window[i].close);
+}
+
+double Database::Indicators::sma(unsigned short period, Queue& window) {
+  for (Sma& sma : smas) {
+    if (sma.period == period) return sma.value();
+  }
+  Sma sma(period);
+  for (unsigned short i = 0; i < period && i < window.size; i++) {
+    sma.count++;
+    sma.sum += window.at(i).close;
+  }
+  smas.push_back(sma);
+  return sma.value();
+}
+
+double Database::Indicators::ema(unsigned short period, Queue& window) {
+  for (Ema& ema : emas) {
+    if (ema.period == period) return ema.ready() ? ema.value : 0;
+  }
+  Ema ema(period);
+  for (unsigned short i = 0; i < window.size; i++) ema.push(window[i].close);
+  emas.push_back(ema);
+  return ema.ready() ? ema.value : 0;
+}
@@ -0,0 +1,131 @@
+#include "pipeline.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <iostream>
+
+Pipeline::Pipeline(Database& _database, size_t capacity)
+  : database(_database), raw(capacity), normalized(capacity), updated(capacity), signals(capacity) {}
+
+const char* Pipeline::name(Stage stage) {
+  static const char* names[STAGES] = {"ingest", "normalize", "bars", "signals", "routing"};
+  return names[stage];
+}
+
+// spin while work is flowing, then yield, then sleep once the stage has been idle a while
+static void back_off(unsigned int& idle) {
+  idle++;
+  if (idle < 1024) return;
+  if (idle < 4096) this_thread::yield();
+  else this_thread::sleep_for(chrono::microseconds(50));
+}
+
+template <typename T>
+void Pipeline::emit(Stage stage, SpscQueue<T>& queue, const T& value) {
+  if (queue.push(value)) return;
+  counters[stage].stalled++;
+  if (drop[stage]) {
+    counters[stage].dropped++;
+    return;
+  }
+  unsigned int idle = 0;
+  while (!queue.push(value)) {
+    if (!running_) return;
+    back_off(idle);
+  }
+}
+
+// run `process` on everything that arrives on `queue` until the pipeline stops
+template <typename T, typename Process>
+static void consume(atomic<bool>& running, SpscQueue<T>& queue, Pipeline::Counters& counters, Process process) {
+  T item;
+  unsigned int idle = 0;
+  while (running) {
+    if (!queue.pop(item)) {
+      back_off(idle);
+      continue;
+    }
+    idle = 0;
+    counters.processed++;
+    process(item);
+  }
+}
+
+static void pin(thread& worker, int core, const char* stage) {
+  if (core < 0) return;
+  cpu_set_t cores;
+  CPU_ZERO(&cores);
+  CPU_SET(core, &cores);
+  if (pthread_setaffinity_np(worker.native_handle(), sizeof(cores), &cores) != 0)
+    cerr << "Unable to pin " << stage << " to core " << core << endl;
+}
+
+void Pipeline::start() {
+  if (running_.exchange(true)) return;
+
+  threads_.emplace_back([this]() {
+    Tick tick;
+    unsigned int idle = 0;
+    while (running_) {
+      if (!source(tick)) {
+        back_off(idle);
+        continue;
+      }
+      idle = 0;
+      counters[INGEST].processed++;
+      emit(INGEST, raw, tick);
+    }
+  });
+
+  threads_.emplace_back([this]() {
+    consume(running_, raw, counters[NORMALIZE], [this](Tick& tick) {
+      // the ticker set is fixed once the Database is built, so this lookup is safe off its lock
+      bool tracked = database.sma_bars.count(tick.ticker) > 0;
+      bool sane = isfinite(tick.last_price) && tick.last_price >= 0 && isfinite(tick.last_size) && tick.last_size >= 0;
+      if (!tracked || !sane) {
+        counters[NORMALIZE].filtered++;
+        return;
+      }
+      if (tick.time == 0) tick.time = ((int64_t) (tick.hour * 60 + tick.minute) * 60 + tick.second) * NANOS_PER_SECOND;
+      emit(NORMALIZE, normalized, tick);
+    });
+  });
+
+  threads_.emplace_back([this]() {
+    consume(running_, normalized, counters[BARS], [this](Tick& tick) {
+      if (database.on_tick(tick)) emit(BARS, updated, tick);
+      else counters[BARS].filtered++;
+    });
+  });
+
+  threads_.emplace_back([this]() {
+    Signal signal;
+    consume(running_, updated, counters[SIGNALS], [this, &signal](Tick& tick) {
+      if (strategy && strategy(tick, signal)) emit(SIGNALS, signals, signal);
+      else counters[SIGNALS].filtered++;
+    });
+  });
+
+  threads_.emplace_back([this]() {
+    consume(running_, signals, counters[ROUTING], [this](Signal& signal) {
+      if (router) router(signal);
+    });
+  });
+
+  for (int stage = 0; stage < STAGES; stage++) pin(threads_[stage], cores[stage], name((Stage) stage));
+}
+
+void Pipeline::stop() {
+  running_ = false;
+  for (thread& worker : threads_) worker.join();
+  threads_.clear();
+}
+
+void Pipeline::report(ostream& out) {
+  size_t queued[STAGES] = {raw.size(), normalized.size(), updated.size(), signals.size(), 0};
+  for (int stage = 0; stage < STAGES; stage++) {
+    Counters& counter = counters[stage];
+    out << name((Stage) stage) << ": processed " << counter.processed << ", filtered " << counter.filtered
+        << ", stalled " << counter.stalled << ", dropped " << counter.dropped << ", queued " << queued[stage] << endl;
+  }
+}
@@ -0,0 +1,143 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "database.h"
+
+using namespace std;
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. The two
+// indexes live on their own cache lines, and each side keeps a stale copy of the other's index
+// so it only touches the shared one when the queue looks full (or empty).
+template <typename T>
+struct SpscQueue {
+  // false when full, the caller decides whether to retry or drop
+  bool push(const T& value) {
+    size_t tail = tail_.load(memory_order_relaxed);
+    if (tail - head_cache_ > mask_) {
+      head_cache_ = head_.load(memory_order_acquire);
+      if (tail - head_cache_ > mask_) return false;
+    }
+    slots_[tail & mask_] = value;
+    tail_.store(tail + 1, memory_order_release);
+    return true;
+  }
+
+  // false when empty
+  bool pop(T& value) {
+    size_t head = head_.load(memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(memory_order_acquire);
+      if (head == tail_cache_) return false;
+    }
+    value = move(slots_[head & mask_]);
+    head_.store(head + 1, memory_order_release);
+    return true;
+  }
+
+  size_t size() const { return tail_.load(memory_order_acquire) - head_.load(memory_order_acquire); }
+  size_t capacity() const { return mask_ + 1; }
+
+  // rounded up to a power of two
+  SpscQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  private:
+    vector<T> slots_;
+    size_t mask_;
+    // consumer side
+    alignas(64) atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;
+    // producer side
+    alignas(64) atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;
+};
+
+// what a strategy wants done, handed from the signal stage to order routing
+struct Signal {
+  string ticker;
+  bool buy = true;
+  double quantity = 0;
+  // 0 for a market order
+  double limit_price = 0;
+  // time of the tick that triggered it, nanoseconds since midnight
+  int64_t time = 0;
+};
+
+// Tick to order path as one thread per stage, connected by SpscQueues:
+//
+//   ingest -> normalize -> bars (Database::on_tick, which also updates the indicators
+//   incrementally under the same lock) -> signals -> routing
+//
+// Every stage counts what it processed, how often it found its output full (stalled) and
+// what it dropped. Each queue either blocks its producer until there is room or drops the
+// newest item; ticks block by default so bars stay exact, signals and orders drop because a
+// late one is worse than none. A stage can be pinned to a core.
+struct Pipeline {
+  enum Stage {
+    INGEST,
+    NORMALIZE,
+    BARS,
+    SIGNALS,
+    ROUTING,
+    STAGES,
+  };
+
+  struct Counters {
+    atomic<uint64_t> processed{0};
+    atomic<uint64_t> stalled{0};
+    atomic<uint64_t> dropped{0};
+    // inputs the stage chose not to pass on, e.g. untracked tickers or ticks that moved no bar
+    atomic<uint64_t> filtered{0};
+  };
+
+  Database& database;
+  // ingest: fill in the next tick, false when there isn't one right now
+  function<bool(Tick& tick)> source;
+  // signals: called for every tick that moved a bar, true to route `signal`
+  function<bool(const Tick& tick, Signal& signal)> strategy;
+  // routing: place the order, e.g. with alpaca::Client::submit_order
+  function<void(const Signal& signal)> router;
+
+  // core for each stage, -1 to leave it to the scheduler
+  int cores[STAGES] = {-1, -1, -1, -1, -1};
+  // drop rather than wait when the stage's output queue is full (routing has no output)
+  bool drop[STAGES] = {false, false, false, true, true};
+  Counters counters[STAGES];
+
+  SpscQueue<Tick> raw;
+  SpscQueue<Tick> normalized;
+  SpscQueue<Tick> updated;
+  SpscQueue<Signal> signals;
+
+  void start();
+  void stop();
+  // one line per stage with its counters and queue depth
+  void report(ostream& out);
+  static const char* name(Stage stage);
+
+  Pipeline(Database& database, size_t capacity = 1 << 14);
+  ~Pipeline() { stop(); }
+
+  private:
+    atomic<bool> running_{false};
+    vector<thread> threads_;
+
+    template <typename T>
+    void emit(Stage stage, SpscQueue<T>& queue, const T& value);
+};
+
+#endif // PIPELINE_H_
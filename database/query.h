@@ -0,0 +1,169 @@
+#ifndef QUERY_H_
+#define QUERY_H_
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <mongocxx/hint.hpp>
+#include <mongocxx/options/find.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/sub_array.hpp>
+#include <bsoncxx/builder/basic/sub_document.hpp>
+
+// Typed clauses for Database::query_database. Every clause is a small value type resolved at
+// compile time, so a query is just a fold over its clauses appending straight into the BSON
+// builders: no heap allocated predicates, virtual calls or typeid checks.
+//
+//   query_database(client, "SPY", query::eq("HOUR", 9), query::range("MINUTE", 30, 45),
+//                  query::sort("SECOND", 1), query::project("LAST_PRICE"), query::exclude("_id"),
+//                  query::limit(500));
+namespace query {
+
+using bsoncxx::builder::basic::kvp;
+using bsoncxx::builder::basic::make_document;
+
+// everything a clause can write into while the query is being built
+struct Builder {
+  bsoncxx::builder::basic::document filter;
+  bsoncxx::builder::basic::document sort;
+  bsoncxx::builder::basic::document projection;
+  mongocxx::options::find options;
+  bool sorted = false;
+  bool projected = false;
+};
+
+// bsoncxx only takes 32 and 64 bit integers, so narrower and unsigned types are widened
+template <typename T>
+auto value(T v) {
+  if constexpr (std::is_same<T, bool>::value) return v;
+  else if constexpr (std::is_integral<T>::value && sizeof(T) < sizeof(int64_t)) return static_cast<int32_t>(v);
+  else if constexpr (std::is_integral<T>::value) return static_cast<int64_t>(v);
+  else return v;
+}
+
+template <typename T>
+struct Eq {
+  const char* key;
+  T v;
+  void apply(Builder& builder) const { builder.filter.append(kvp(key, value(v))); }
+};
+
+template <typename T>
+struct Compare {
+  const char* key;
+  const char* op;
+  T v;
+  void apply(Builder& builder) const { builder.filter.append(kvp(key, make_document(kvp(op, value(v))))); }
+};
+
+template <typename T>
+struct Range {
+  const char* key;
+  T low, high;
+  bool inclusive;
+  void apply(Builder& builder) const {
+    builder.filter.append(kvp(key, [this](bsoncxx::builder::basic::sub_document range) {
+      if (inclusive) range.append(kvp("$gte", value(low)), kvp("$lte", value(high)));
+      else range.append(kvp("$gt", value(low)), kvp("$lt", value(high)));
+    }));
+  }
+};
+
+// $or over filters built with query::filter
+template <size_t N>
+struct AnyOf {
+  std::array<bsoncxx::document::value, N> filters;
+  void apply(Builder& builder) const {
+    builder.filter.append(kvp("$or", [this](bsoncxx::builder::basic::sub_array any) {
+      for (const bsoncxx::document::value& filter : filters) any.append(filter.view());
+    }));
+  }
+};
+
+struct Sort {
+  const char* key;
+  int direction;
+  void apply(Builder& builder) const {
+    builder.sort.append(kvp(key, direction));
+    builder.sorted = true;
+  }
+};
+
+template <size_t N>
+struct Project {
+  std::array<const char*, N> keys;
+  void apply(Builder& builder) const {
+    for (const char* key : keys) builder.projection.append(kvp(key, 1));
+    builder.projected = true;
+  }
+};
+
+template <size_t N>
+struct Exclude {
+  std::array<const char*, N> keys;
+  void apply(Builder& builder) const {
+    for (const char* key : keys) builder.projection.append(kvp(key, 0));
+    builder.projected = true;
+  }
+};
+
+struct Limit {
+  int64_t count;
+  void apply(Builder& builder) const { builder.options.limit(count); }
+};
+
+struct Hint {
+  const char* index;
+  void apply(Builder& builder) const { builder.options.hint(mongocxx::hint{index}); }
+};
+
+struct AllowDiskUse {
+  void apply(Builder& builder) const { builder.options.allow_disk_use(true); }
+};
+
+template <typename T> Eq<T> eq(const char* key, T v) { return {key, v}; }
+template <typename T> Compare<T> gt(const char* key, T v) { return {key, "$gt", v}; }
+template <typename T> Compare<T> gte(const char* key, T v) { return {key, "$gte", v}; }
+template <typename T> Compare<T> lt(const char* key, T v) { return {key, "$lt", v}; }
+template <typename T> Compare<T> lte(const char* key, T v) { return {key, "$lte", v}; }
+template <typename T> Range<T> range(const char* key, T low, T high, bool inclusive = true) { return {key, low, high, inclusive}; }
+template <typename... Filters>
+AnyOf<sizeof...(Filters)> any_of(Filters... filters) { return {{std::move(filters)...}}; }
+
+inline Sort sort(const char* key, int direction = 1) { return {key, direction}; }
+template <typename... Keys>
+Project<sizeof...(Keys)> project(Keys... keys) { return {{keys...}}; }
+// only "_id" may be excluded alongside an inclusion projection
+template <typename... Keys>
+Exclude<sizeof...(Keys)> exclude(Keys... keys) { return {{keys...}}; }
+inline Limit limit(int64_t count) { return {count}; }
+// index name, e.g. "HOUR_1_MINUTE_1_SECOND_1"
+inline Hint hint(const char* index) { return {index}; }
+// let a sort the index can't serve spill to disk instead of failing past 100MB (MongoDB 4.4)
+inline AllowDiskUse allow_disk_use() { return {}; }
+
+// filter document on its own, for $match stages
+template <typename... Clauses>
+bsoncxx::document::value filter(const Clauses&... clauses) {
+  Builder builder;
+  (clauses.apply(builder), ...);
+  return builder.filter.extract();
+}
+
+// filter plus find options for collection::find
+template <typename... Clauses>
+bsoncxx::document::value build(mongocxx::options::find& options, const Clauses&... clauses) {
+  Builder builder;
+  (clauses.apply(builder), ...);
+  if (builder.sorted) builder.options.sort(builder.sort.extract());
+  if (builder.projected) builder.options.projection(builder.projection.extract());
+  options = builder.options;
+  return builder.filter.extract();
+}
+
+} // namespace query
+
+#endif // QUERY_H_
@@ -0,0 +1,66 @@
+#include "quotes.h"
+
+#include <utility>
+#include <tuple>
+
+using namespace std;
+
+QuoteBook::QuoteBook(const vector<string>& tickers) {
+  for (const string& ticker : tickers) slots.emplace(piecewise_construct, forward_as_tuple(ticker), forward_as_tuple());
+}
+
+static void publish(QuoteBook::Slot& slot, const Quote& quote) {
+  uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+  slot.sequence.store(sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot.bid_price.store(quote.bid_price, memory_order_relaxed);
+  slot.ask_price.store(quote.ask_price, memory_order_relaxed);
+  slot.bid_size.store(quote.bid_size, memory_order_relaxed);
+  slot.ask_size.store(quote.ask_size, memory_order_relaxed);
+  slot.time.store(quote.time, memory_order_relaxed);
+  slot.average_spread.store(quote.average_spread, memory_order_relaxed);
+  slot.average_imbalance.store(quote.average_imbalance, memory_order_relaxed);
+  slot.updates.store(quote.updates, memory_order_relaxed);
+  slot.sequence.store(sequence + 2, memory_order_release);
+}
+
+bool QuoteBook::update(const string& ticker, double bid_price, double ask_price, double bid_size, double ask_size, int64_t time) {
+  unordered_map<string, Slot>::iterator found = slots.find(ticker);
+  if (found == slots.end()) return false;
+  Quote& quote = found->second.last;
+  if (bid_price > 0) quote.bid_price = bid_price;
+  if (ask_price > 0) quote.ask_price = ask_price;
+  if (bid_size > 0) quote.bid_size = bid_size;
+  if (ask_size > 0) quote.ask_size = ask_size;
+  quote.time = time;
+  if (!quote.valid()) return true;
+
+  // seeded with the first value, then weighted like an EMA over QUOTE_WINDOW updates
+  double alpha = quote.updates == 0 ? 1 : 2.0 / (QUOTE_WINDOW + 1);
+  quote.average_spread += alpha * (quote.spread() - quote.average_spread);
+  quote.average_imbalance += alpha * (quote.imbalance() - quote.average_imbalance);
+  quote.updates++;
+  publish(found->second, quote);
+  return true;
+}
+
+bool QuoteBook::get(const string& ticker, Quote& quote) const {
+  unordered_map<string, Slot>::const_iterator found = slots.find(ticker);
+  if (found == slots.end()) return false;
+  const Slot& slot = found->second;
+  uint64_t before, after;
+  do {
+    before = slot.sequence.load(memory_order_acquire);
+    quote.bid_price = slot.bid_price.load(memory_order_relaxed);
+    quote.ask_price = slot.ask_price.load(memory_order_relaxed);
+    quote.bid_size = slot.bid_size.load(memory_order_relaxed);
+    quote.ask_size = slot.ask_size.load(memory_order_relaxed);
+    quote.time = slot.time.load(memory_order_relaxed);
+    quote.average_spread = slot.average_spread.load(memory_order_relaxed);
+    quote.average_imbalance = slot.average_imbalance.load(memory_order_relaxed);
+    quote.updates = slot.updates.load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    after = slot.sequence.load(memory_order_relaxed);
+  } while (before != after || (before & 1));
+  return quote.updates > 0;
+}
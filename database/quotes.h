@@ -0,0 +1,56 @@
+#ifndef QUOTES_H_
+#define QUOTES_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// updates the spread and imbalance averages reach back over, roughly
+const unsigned int QUOTE_WINDOW = 100;
+
+// top of book for one symbol plus exponentially weighted stats over recent updates
+struct Quote {
+  double bid_price = 0, ask_price = 0, bid_size = 0, ask_size = 0;
+  // nanoseconds since midnight exchange time of the last update
+  int64_t time = 0;
+  double average_spread = 0;
+  double average_imbalance = 0;
+  uint64_t updates = 0;
+
+  bool valid() const { return bid_price > 0 && ask_price > 0; }
+  double spread() const { return ask_price - bid_price; }
+  double midprice() const { return (bid_price + ask_price) / 2; }
+  // -1 when all the size is on the ask, 1 when it is all on the bid
+  double imbalance() const { return bid_size + ask_size > 0 ? (bid_size - ask_size) / (bid_size + ask_size) : 0; }
+};
+
+// Latest quote per symbol behind a sequence lock: one writer per symbol (the tick thread)
+// publishes without blocking, and any number of readers copy a consistent snapshot without
+// taking a lock, retrying only if they overlap a write. The symbol set is fixed at construction
+// so lookups never race with inserts.
+struct QuoteBook {
+  struct Slot {
+    // odd while a write is in progress
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<double> bid_price{0}, ask_price{0}, bid_size{0}, ask_size{0};
+    std::atomic<int64_t> time{0};
+    std::atomic<double> average_spread{0}, average_imbalance{0};
+    std::atomic<uint64_t> updates{0};
+    // the writer's own copy, never read by other threads
+    Quote last;
+  };
+
+  std::unordered_map<std::string, Slot> slots;
+
+  // fields passed as 0 keep their previous value, the stream only sends what changed;
+  // false for an unknown symbol
+  bool update(const std::string& ticker, double bid_price, double ask_price, double bid_size, double ask_size, int64_t time);
+  // false for an unknown symbol or one with no quote yet
+  bool get(const std::string& ticker, Quote& quote) const;
+
+  QuoteBook(const std::vector<std::string>& tickers);
+};
+
+#endif // QUOTES_H_
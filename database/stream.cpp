@@ -0,0 +1,220 @@
+#include "database.h"
+#include "tick_ring.h"
+
+#include <ctime>
+
+#include <mongocxx/exception/operation_exception.hpp>
+#include <mongocxx/options/change_stream.hpp>
+
+bool Database::on_tick(const Tick& tick) {
+  // quote only updates move the book even though they don't touch the bars
+  quotes.update(tick.ticker, tick.bid_price, tick.ask_price, tick.bid_size, tick.ask_size, tick.time);
+  unordered_map<string, Queue>::iterator found = sma_bars.find(tick.ticker);
+  if (found == sma_bars.end() || tick.last_price == 0) return false;
+  Queue& window = found->second;
+  Indicators& state = indicators.at(tick.ticker);
+  BarBuilder& builder = builders.at(tick.ticker);
+  Session& session = sessions.at(tick.ticker);
+  // bars handed to subscribers once the lock is released
+  shared_ptr<const vector<pair<Timeframe, function<void(const Bar&, bool)>>>> subscribers;
+  vector<pair<size_t, Bar>> updates;
+  vector<bool> closed;
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    unsigned short minute = tick.hour * 60 + tick.minute;
+    unsigned short last = window.last_hour * 60 + window.last_min;
+    // the live process runs across days; the morning's first tick is earlier than yesterday's close
+    if (!window.isEmpty() && minute < last) {
+      int day = local_day();
+      if (day != day_) {
+        day_ = day;
+        reset_day();
+        last = 0;
+      }
+    }
+    double size = trade_size(tick, session.total_volume);
+    if (!window.isEmpty() && minute == last) {
+      Bar& bar = window.back();
+      double close = bar.close;
+      bar.close = tick.last_price;
+      if (tick.last_price < bar.low) bar.low = tick.last_price;
+      if (tick.last_price > bar.high) bar.high = tick.last_price;
+      bar.volume += size;
+      bar.notional += tick.last_price * size;
+      bar.ticks++;
+      state.revise(close, bar.close);
+    }
+    else if (window.isEmpty() || minute > last) {
+      Bar bar(tick.ticker, tick.hour, tick.minute, tick.last_price, tick.last_price, tick.last_price, tick.last_price, size);
+      bar.notional = tick.last_price * size;
+      bar.ticks = 1;
+      state.push(window, bar);
+      window.enqueue(bar);
+      window.last_hour = tick.hour;
+      window.last_min = tick.minute;
+    }
+    // ticks for a minute that has already rolled off the live bar are dropped
+    else return false;
+
+    session.volume += size;
+    session.notional += tick.last_price * size;
+    session.ticks++;
+
+    if (builder.on_tick(tick.last_price, size, (tick.hour * 60 + tick.minute) * 60 + tick.second)) {
+      subscribers = subscribers_;
+      for (size_t i = 0; i < subscribers->size(); i++) {
+        unsigned int level = BarBuilder::level((*subscribers)[i].first);
+        if (builder.closed_mask & (1 << level)) {
+          updates.emplace_back(i, builder.closed[level]);
+          closed.push_back(true);
+        }
+        Bar bar;
+        if (builder.current(level, bar)) {
+          updates.emplace_back(i, bar);
+          closed.push_back(false);
+        }
+      }
+    }
+  }
+  notify();
+  for (size_t i = 0; i < updates.size(); i++) (*subscribers)[updates[i].first].second(updates[i].second, closed[i]);
+  return true;
+}
+
+void Database::subscribe(Timeframe timeframe, function<void(const Bar& bar, bool closed)> callback) {
+  lock_guard<mutex> lock(mutex_);
+  auto subscribers = make_shared<vector<pair<Timeframe, function<void(const Bar&, bool)>>>>(*subscribers_);
+  subscribers->emplace_back(timeframe, callback);
+  subscribers_ = subscribers;
+}
+
+bool Database::get_current_bar(string ticker, Timeframe timeframe, Bar& bar) {
+  lock_guard<mutex> lock(mutex_);
+  unordered_map<string, BarBuilder>::iterator found = builders.find(ticker);
+  if (found == builders.end()) return false;
+  return found->second.current(BarBuilder::level(timeframe), bar);
+}
+
+void Database::roll_day() {
+  lock_guard<mutex> lock(mutex_);
+  day_ = local_day();
+  reset_day();
+}
+
+void Database::reset_day() {
+  for (pair<const string, Queue>& window : sma_bars) {
+    window.second.last_hour = 0;
+    window.second.last_min = 0;
+  }
+  for (pair<const string, BarBuilder>& builder : builders) builder.second = BarBuilder(builder.first);
+  for (pair<const string, Session>& session : sessions) session.second = Session();
+}
+
+int Database::local_day() {
+  time_t now = time(nullptr);
+  tm local;
+  localtime_r(&now, &local);
+  return local.tm_year * 366 + local.tm_yday;
+}
+
+bool Database::watch() {
+  if (watching || !pool_) return watching;
+  // a stream that closed on an error leaves its finished thread to be joined
+  if (watcher_.joinable()) watcher_.join();
+
+  mongocxx::pipeline pipeline;
+  pipeline.match(make_document(
+    kvp("operationType", make_document(kvp("$in", bsoncxx::builder::basic::make_array("insert", "drop")))),
+    kvp("ns.coll", make_document(kvp("$in", [this](bsoncxx::builder::basic::sub_array collections) {
+      for (const string& ticker : tickers) collections.append(ticker);
+    })))
+  ));
+  // only ship the fields on_tick reads, _id stays since it is the resume token
+  pipeline.project(make_document(
+    kvp("operationType", 1), kvp("ns", 1),
+    kvp("fullDocument.key", 1), kvp("fullDocument.LAST_PRICE", 1), kvp("fullDocument.LAST_SIZE", 1), kvp("fullDocument.TOTAL_VOLUME", 1),
+    kvp("fullDocument.BID_PRICE", 1), kvp("fullDocument.ASK_PRICE", 1),
+    kvp("fullDocument.BID_SIZE", 1), kvp("fullDocument.ASK_SIZE", 1),
+    kvp("fullDocument.HOUR", 1), kvp("fullDocument.MINUTE", 1), kvp("fullDocument.SECOND", 1)
+  ));
+  mongocxx::options::change_stream options;
+  options.max_await_time(chrono::milliseconds(500));
+
+  // open the stream here so an unsupported deployment is reported to the caller
+  mongocxx::pool::entry client = pool_->acquire();
+  mongocxx::stdx::optional<mongocxx::change_stream> opened;
+  try {
+    opened.emplace((*client)[database_name_].watch(pipeline, options));
+  }
+  catch (const mongocxx::operation_exception& e) {
+    cerr << "Unable to open change stream: " << e.what() << endl;
+    return false;
+  }
+
+  watching = true;
+  watcher_ = thread([this, client = move(client), stream = move(*opened)]() mutable {
+    try {
+      while (watching) {
+        // iteration ends whenever max_await_time passes without a new insert
+        for (const bsoncxx::document::view& event : stream) {
+          // the stream script drops every collection each morning, taking the index with it
+          if (event["operationType"].get_utf8().value == "drop") ensure_index(string(event["ns"]["coll"].get_utf8().value));
+          else on_tick(to_tick(string(event["ns"]["coll"].get_utf8().value), event["fullDocument"].get_document().value));
+          if (!watching) break;
+        }
+      }
+    }
+    catch (const mongocxx::operation_exception& e) {
+      cerr << "Change stream closed: " << e.what() << endl;
+      watching = false;
+      notify();
+    }
+  });
+  return true;
+}
+
+bool Database::follow(string name) {
+  if (watching) return watching;
+  if (watcher_.joinable()) watcher_.join();
+  TickRing ring;
+  if (!ring.open(name)) {
+    cerr << "Unable to open tick ring " << name << endl;
+    return false;
+  }
+
+  watching = true;
+  watcher_ = thread([this, ring = move(ring)]() mutable {
+    Tick tick;
+    unsigned int idle = 0;
+    while (watching) {
+      if (ring.read(tick)) {
+        on_tick(tick);
+        idle = 0;
+      }
+      // spin while ticks are flowing, back off once the feed goes quiet
+      else if (++idle > 4096) this_thread::sleep_for(chrono::microseconds(50));
+    }
+    if (ring.lost > 0) cerr << "Tick ring overran " << ring.lost << " ticks" << endl;
+  });
+  return true;
+}
+
+void Database::stop_watching() {
+  watching = false;
+  if (watcher_.joinable()) watcher_.join();
+}
+
+void Database::notify() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    version_++;
+  }
+  updated_.notify_all();
+}
+
+unsigned long Database::wait_for_update(unsigned long version) {
+  unique_lock<mutex> lock(mutex_);
+  updated_.wait(lock, [this, version]() { return version_ != version || !watching; });
+  return version_;
+}
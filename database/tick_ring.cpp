@@ -0,0 +1,171 @@
+#include "tick_ring.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t slots_offset() {
+  return (sizeof(TickRingHeader) + 63) & ~(size_t) 63;
+}
+
+static bool map(TickRing& ring, int fd, size_t bytes, bool writable) {
+  void* base = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) return false;
+  ring.header = (TickRingHeader*) base;
+  ring.slots = (TickSlot*) ((char*) base + slots_offset());
+  ring.bytes = bytes;
+  return true;
+}
+
+bool TickRing::create(string name, uint32_t _capacity) {
+  close();
+  uint32_t capacity = 1;
+  while (capacity < _capacity) capacity <<= 1;
+  size_t size = slots_offset() + (size_t) capacity * sizeof(TickSlot);
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) return false;
+  // consumers still mapping an old segment of another size would fault if it were resized under them
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size != 0 && (size_t) info.st_size != size) {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return false;
+  }
+  if (ftruncate(fd, size) != 0 || !map(*this, fd, size, true)) {
+    ::close(fd);
+    return false;
+  }
+
+  // restarting the producer starts the sequence over, consumers notice head going backwards
+  header->head.store(0, memory_order_relaxed);
+  for (uint32_t i = 0; i < capacity; i++) slots[i].sequence.store(0, memory_order_relaxed);
+  memcpy(header->magic, TICK_RING_MAGIC, sizeof(TICK_RING_MAGIC));
+  header->version = TICK_RING_VERSION;
+  header->capacity = capacity;
+  atomic_thread_fence(memory_order_release);
+  producer = true;
+  return true;
+}
+
+bool TickRing::open(string name) {
+  close();
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(TickRingHeader)) {
+    ::close(fd);
+    return false;
+  }
+  if (!map(*this, fd, info.st_size, false)) return false;
+  bool valid = memcmp(header->magic, TICK_RING_MAGIC, sizeof(TICK_RING_MAGIC)) == 0 && header->version == TICK_RING_VERSION
+    && slots_offset() + (size_t) header->capacity * sizeof(TickSlot) <= bytes;
+  if (!valid) {
+    close();
+    return false;
+  }
+  producer = false;
+  next = header->head.load(memory_order_acquire);
+  lost = 0;
+  return true;
+}
+
+void TickRing::close() {
+  if (header != nullptr) munmap(header, bytes);
+  header = nullptr;
+  slots = nullptr;
+  bytes = 0;
+}
+
+TickRing::TickRing(TickRing&& other) {
+  *this = move(other);
+}
+
+TickRing& TickRing::operator=(TickRing&& other) {
+  if (this == &other) return *this;
+  close();
+  header = other.header;
+  slots = other.slots;
+  bytes = other.bytes;
+  producer = other.producer;
+  next = other.next;
+  lost = other.lost.load();
+  other.header = nullptr;
+  other.slots = nullptr;
+  other.bytes = 0;
+  return *this;
+}
+
+void TickRing::publish(const Tick& tick) {
+  TickRecord record;
+  memset(&record, 0, sizeof(record));
+  strncpy(record.ticker, tick.ticker.c_str(), sizeof(record.ticker) - 1);
+  record.last_price = tick.last_price;
+  record.last_size = tick.last_size;
+  record.total_volume = tick.total_volume;
+  record.bid_price = tick.bid_price;
+  record.ask_price = tick.ask_price;
+  record.bid_size = tick.bid_size;
+  record.ask_size = tick.ask_size;
+  record.time = tick.time;
+  record.hour = tick.hour;
+  record.minute = tick.minute;
+  record.second = tick.second;
+  uint64_t words[sizeof(TickRecord) / sizeof(uint64_t)];
+  memcpy(words, &record, sizeof(record));
+
+  uint64_t n = header->head.load(memory_order_relaxed);
+  TickSlot& slot = slots[n & (header->capacity - 1)];
+  slot.sequence.store(2 * n + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  for (size_t i = 0; i < sizeof(words) / sizeof(uint64_t); i++) slot.words[i].store(words[i], memory_order_relaxed);
+  slot.sequence.store(2 * n + 2, memory_order_release);
+  header->head.store(n + 1, memory_order_release);
+}
+
+bool TickRing::read(Tick& tick) {
+  uint64_t capacity = header->capacity;
+  uint64_t words[sizeof(TickRecord) / sizeof(uint64_t)];
+  while (true) {
+    uint64_t head = header->head.load(memory_order_acquire);
+    // the producer restarted
+    if (next > head) next = head;
+    if (next == head) return false;
+    if (head - next > capacity) {
+      lost.fetch_add(head - capacity - next, memory_order_relaxed);
+      next = head - capacity;
+    }
+
+    const TickSlot& slot = slots[next & (capacity - 1)];
+    uint64_t before = slot.sequence.load(memory_order_acquire);
+    for (size_t i = 0; i < sizeof(words) / sizeof(uint64_t); i++) words[i] = slot.words[i].load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = slot.sequence.load(memory_order_relaxed);
+    if (before == 2 * next + 2 && after == before) break;
+    // overwritten while we read it, the slot after it is the oldest that can still be intact
+    lost.fetch_add(1, memory_order_relaxed);
+    next++;
+  }
+  next++;
+
+  TickRecord record;
+  memcpy(&record, words, sizeof(record));
+  record.ticker[sizeof(record.ticker) - 1] = '\0';
+  tick.ticker = record.ticker;
+  tick.last_price = record.last_price;
+  tick.last_size = record.last_size;
+  tick.total_volume = record.total_volume;
+  tick.bid_price = record.bid_price;
+  tick.ask_price = record.ask_price;
+  tick.bid_size = record.bid_size;
+  tick.ask_size = record.ask_size;
+  tick.time = record.time;
+  tick.hour = record.hour;
+  tick.minute = record.minute;
+  tick.second = record.second;
+  return true;
+}
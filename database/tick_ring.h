@@ -0,0 +1,77 @@
+#ifndef TICK_RING_H_
+#define TICK_RING_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include "database.h"
+
+using namespace std;
+
+// Single producer, multi consumer ring of fixed size tick records in a POSIX shared memory
+// segment, so the ingester can hand ticks to strategy processes on the same host without a
+// round trip through Mongo (which stays the durable copy).
+//
+// Tick n lives in slot n % capacity. Each slot carries its own sequence number: the producer
+// sets it to 2n + 1 before writing the record and 2n + 2 after, then bumps the header's head
+// to n + 1. A consumer reading tick n copies the record between two loads of the sequence and
+// keeps it only if both read 2n + 2; anything larger means the producer has lapped it, and the
+// consumer skips ahead to the oldest tick still in the ring, counting the ones it lost.
+// Consumers never write to the segment, so any number of them can follow the same ring.
+const char TICK_RING_MAGIC[8] = {'T', 'I', 'C', 'K', 'R', 'I', 'N', 'G'};
+const uint32_t TICK_RING_VERSION = 1;
+
+// the binary form of a Tick as it sits in a slot
+struct TickRecord {
+  char ticker[16];
+  double last_price, last_size, total_volume;
+  double bid_price, ask_price, bid_size, ask_size;
+  int64_t time;
+  uint16_t hour, minute, second, padding;
+};
+
+struct alignas(64) TickSlot {
+  atomic<uint64_t> sequence;
+  // the record copied in and out a word at a time so readers racing the writer stay well defined
+  atomic<uint64_t> words[sizeof(TickRecord) / sizeof(uint64_t)];
+};
+
+struct TickRingHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t capacity;
+  alignas(64) atomic<uint64_t> head;
+};
+
+struct TickRing {
+  TickRingHeader* header = nullptr;
+  TickSlot* slots = nullptr;
+  size_t bytes = 0;
+  bool producer = false;
+  // consumer side: next tick to read and how many were overwritten before it got to them,
+  // `lost` readable from other threads while the consumer reads
+  uint64_t next = 0;
+  atomic<uint64_t> lost{0};
+
+  // producer: create the segment, or reset an existing one, with room for `capacity` ticks
+  // (rounded up to a power of two)
+  bool create(string name, uint32_t capacity);
+  // consumer: attach to a ring the producer created and start at its newest tick
+  bool open(string name);
+  void close();
+  bool isOpen() { return header != nullptr; }
+
+  void publish(const Tick& tick);
+  // false when there is nothing new yet
+  bool read(Tick& tick);
+
+  TickRing() {}
+  TickRing(const TickRing&) = delete;
+  TickRing& operator=(const TickRing&) = delete;
+  TickRing(TickRing&& other);
+  TickRing& operator=(TickRing&& other);
+  ~TickRing() { close(); }
+};
+
+#endif // TICK_RING_H_
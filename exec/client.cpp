@@ -20,13 +20,49 @@ httplib::Headers headers(const Environment& environment) {
   };
 }
 
-Client::Client(Environment& environment) {
+/**
+ * @brief Deserialize a JSON array of orders in one pass.
+ *
+ * `body` is parsed in place, so the document's strings point into it rather
+ * than being copied, and each Order is filled straight from its element.
+ * `body` is left clobbered.
+ */
+Status parseOrders(std::string& body, std::vector<Order>& orders) {
+  rapidjson::Document d;
+  if (d.ParseInsitu(&body[0]).HasParseError()) {
+    return Status(1, "Received parse error when deserializing orders JSON");
+  }
+  if (!d.IsArray()) {
+    return Status(1, "Deserialized valid JSON but it wasn't an array of orders");
+  }
+  orders.reserve(d.Size());
+  for (auto& o : d.GetArray()) {
+    Order order;
+    if (auto status = order.fromJSON(o); !status.ok()) {
+      return status;
+    }
+    orders.push_back(std::move(order));
+  }
+  return Status();
+}
+
+Client::Client(Environment& environment, const std::size_t connections) {
   if (!environment.hasBeenParsed()) {
     if (auto s = environment.parse(); !s.ok()) {
       LOG(ERROR) << "Error parsing the environment: " << s.getMessage();
     }
   }
   environment_ = environment;
+
+  connections_ = std::make_shared<ConnectionPool>(environment_.getAPIBaseURL(), connections);
+  dispatcher_ = std::make_shared<Dispatcher>(connections_->size());
+  auto connected = connections_->warmUp([this](httplib::SSLClient& client) {
+    return static_cast<bool>(client.Get("/v2/clock", headers(environment_)));
+  });
+  if (connected < connections_->size()) {
+    LOG(WARNING) << "Only " << connected << " of " << connections_->size() << " connections to "
+                 << environment_.getAPIBaseURL() << " could be opened";
+  }
 }
 
 std::pair<Status, Order> Client::get_order(const std::string& id, const bool nested) const {
@@ -37,9 +73,9 @@ std::pair<Status, Order> Client::get_order(const std::string& id, const bool nes
     url += "?nested=true";
   }
 
-  httplib::SSLClient client(environment_.getAPIBaseURL());
+  auto client = connections_->acquire();
   DLOG(INFO) << "Making request to: " << url;
-  auto resp = client.Get(url.c_str(), headers(environment_));
+  auto resp = client->Get(url.c_str(), headers(environment_));
   if (!resp) {
     std::ostringstream ss;
     ss << "Call to " << url << " returned an empty response";
@@ -61,9 +97,9 @@ std::pair<Status, Order> Client::get_order_by_client_id(const std::string& clien
 
   auto url = "/v2/orders:by_client_order_id?client_order_id=" + client_order_id;
 
-  httplib::SSLClient client(environment_.getAPIBaseURL());
+  auto client = connections_->acquire();
   DLOG(INFO) << "Making request to: " << url;
-  auto resp = client.Get(url.c_str(), headers(environment_));
+  auto resp = client->Get(url.c_str(), headers(environment_));
   if (!resp) {
     std::ostringstream ss;
     ss << "Call to " << url << " returned an empty response";
@@ -103,10 +139,10 @@ std::pair<Status, std::vector<Order>> Client::get_orders(const ActionStatus stat
     params.insert({"nested", "true"});
   }
   auto query_string = httplib::detail::params_to_query_str(params);
-  httplib::SSLClient client(environment_.getAPIBaseURL());
+  auto client = connections_->acquire();
   auto url = "/v2/orders?" + query_string;
   DLOG(INFO) << "Making request to: " << url;
-  auto resp = client.Get(url.c_str(), headers(environment_));
+  auto resp = client->Get(url.c_str(), headers(environment_));
   if (!resp) {
     std::ostringstream ss;
     ss << "Call to " << url << " returned an empty response";
@@ -121,39 +157,21 @@ std::pair<Status, std::vector<Order>> Client::get_orders(const ActionStatus stat
 
   DLOG(INFO) << "Response from " << url << ": " << resp->body;
 
-  rapidjson::Document d;
-  if (d.Parse(resp->body.c_str()).HasParseError()) {
-    return std::make_pair(Status(1, "Received parse error when deserializing orders JSON"), orders);
-  }
-  for (auto& o : d.GetArray()) {
-    Order order;
-    rapidjson::StringBuffer s;
-    s.Clear();
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
-    o.Accept(writer);
-    if (auto status = order.fromJSON(s.GetString()); !status.ok()) {
-      return std::make_pair(status, orders);
-    }
-    orders.push_back(order);
-  }
-
-  return std::make_pair(Status(), orders);
+  return std::make_pair(parseOrders(resp->body, orders), orders);
 }
 
-std::pair<Status, Order> Client::submit_order(const std::string& symbol,
-                                             const int quantity,
-                                             const OrderSide side,
-                                             const OrderType type,
-                                             const OrderTimeInForce tif,
-                                             const std::string& limit_price,
-                                             const std::string& stop_price,
-                                             const bool extended_hours,
-                                             const std::string& client_order_id,
-                                             const OrderClass order_class,
-                                             TakeProfitParams* take_profit_params,
-                                             StopLossParams* stop_loss_params) const {
-  Order order;
-
+std::string submitOrderBody(const std::string& symbol,
+                            const int quantity,
+                            const OrderSide side,
+                            const OrderType type,
+                            const OrderTimeInForce tif,
+                            const std::string& limit_price,
+                            const std::string& stop_price,
+                            const bool extended_hours,
+                            const std::string& client_order_id,
+                            const OrderClass order_class,
+                            TakeProfitParams* take_profit_params,
+                            StopLossParams* stop_loss_params) {
   rapidjson::StringBuffer s;
   s.Clear();
   rapidjson::Writer<rapidjson::StringBuffer> writer(s);
@@ -224,12 +242,40 @@ std::pair<Status, Order> Client::submit_order(const std::string& symbol,
   }
 
   writer.EndObject();
-  auto body = s.GetString();
+  return s.GetString();
+}
+
+std::pair<Status, Order> Client::submit_order(const std::string& symbol,
+                                             const int quantity,
+                                             const OrderSide side,
+                                             const OrderType type,
+                                             const OrderTimeInForce tif,
+                                             const std::string& limit_price,
+                                             const std::string& stop_price,
+                                             const bool extended_hours,
+                                             const std::string& client_order_id,
+                                             const OrderClass order_class,
+                                             TakeProfitParams* take_profit_params,
+                                             StopLossParams* stop_loss_params) const {
+  Order order;
+
+  auto body = submitOrderBody(symbol,
+                              quantity,
+                              side,
+                              type,
+                              tif,
+                              limit_price,
+                              stop_price,
+                              extended_hours,
+                              client_order_id,
+                              order_class,
+                              take_profit_params,
+                              stop_loss_params);
 
   std::cout << "Sending request body to /v2/orders: " << body << std::endl;
 
-  httplib::SSLClient client(environment_.getAPIBaseURL());
-  auto resp = client.Post("/v2/orders", headers(environment_), body, kJSONContentType);
+  auto client = connections_->acquire();
+  auto resp = client->Post("/v2/orders", headers(environment_), body, kJSONContentType);
   if (!resp) {
     return std::make_pair(Status(1, "Call to /v2/orders returned an empty response"), order);
   }
@@ -245,6 +291,47 @@ std::pair<Status, Order> Client::submit_order(const std::string& symbol,
   return std::make_pair(order.fromJSON(resp->body), order);
 }
 
+std::pair<Status, std::vector<std::pair<Status, Order>>> Client::submit_orders(
+    const std::vector<OrderRequest>& basket) const {
+  std::vector<std::future<std::pair<Status, Order>>> pending;
+  pending.reserve(basket.size());
+  for (const auto& request : basket) {
+    auto take_profit = request.take_profit;
+    auto stop_loss = request.stop_loss;
+    pending.push_back(submit_order_async(request.symbol,
+                                         request.quantity,
+                                         request.side,
+                                         request.type,
+                                         request.tif,
+                                         request.limit_price,
+                                         request.stop_price,
+                                         request.extended_hours,
+                                         request.client_order_id,
+                                         request.order_class,
+                                         take_profit ? &*take_profit : nullptr,
+                                         stop_loss ? &*stop_loss : nullptr));
+  }
+
+  std::vector<std::pair<Status, Order>> results;
+  results.reserve(basket.size());
+  std::size_t failed = 0;
+  std::ostringstream ss;
+  for (std::size_t i = 0; i < pending.size(); i++) {
+    results.push_back(pending[i].get());
+    if (auto status = results.back().first; !status.ok()) {
+      if (failed++ == 0) {
+        ss << basket[i].symbol << ": " << status.getMessage();
+      }
+    }
+  }
+  if (failed > 0) {
+    std::ostringstream summary;
+    summary << failed << " of " << basket.size() << " orders failed, the first was " << ss.str();
+    return std::make_pair(Status(1, summary.str()), results);
+  }
+  return std::make_pair(Status(), results);
+}
+
 std::pair<Status, Order> Client::replace_order(const std::string& id,
                                               const int quantity,
                                               const OrderTimeInForce tif,
@@ -285,8 +372,8 @@ std::pair<Status, Order> Client::replace_order(const std::string& id,
   auto url = "/v2/orders/" + id;
   DLOG(INFO) << "Sending request body to " << url << ": " << body;
 
-  httplib::SSLClient client(environment_.getAPIBaseURL());
-  auto resp = client.Patch(url.c_str(), headers(environment_), body, kJSONContentType);
+  auto client = connections_->acquire();
+  auto resp = client->Patch(url.c_str(), headers(environment_), body, kJSONContentType);
   if (!resp) {
     std::ostringstream ss;
     ss << "Call to " << url << " returned an empty response";
@@ -307,9 +394,9 @@ std::pair<Status, Order> Client::replace_order(const std::string& id,
 std::pair<Status, std::vector<Order>> Client::cancel_orders() const {
   std::vector<Order> orders;
 
-  httplib::SSLClient client(environment_.getAPIBaseURL());
+  auto client = connections_->acquire();
   DLOG(INFO) << "Making request to: /v2/orders";
-  auto resp = client.Delete("/v2/orders", headers(environment_));
+  auto resp = client->Delete("/v2/orders", headers(environment_));
   if (!resp) {
     return std::make_pair(Status(1, "Call to /v2/orders returned an empty response"), orders);
   }
@@ -322,32 +409,16 @@ std::pair<Status, std::vector<Order>> Client::cancel_orders() const {
 
   DLOG(INFO) << "Response from /v2/orders: " << resp->body;
 
-  rapidjson::Document d;
-  if (d.Parse(resp->body.c_str()).HasParseError()) {
-    return std::make_pair(Status(1, "Received parse error when deserializing orders JSON"), orders);
-  }
-  for (auto& o : d.GetArray()) {
-    Order order;
-    rapidjson::StringBuffer s;
-    s.Clear();
-    rapidjson::Writer<rapidjson::StringBuffer> writer(s);
-    o.Accept(writer);
-    if (auto status = order.fromJSON(s.GetString()); !status.ok()) {
-      return std::make_pair(status, orders);
-    }
-    orders.push_back(order);
-  }
-
-  return std::make_pair(Status(), orders);
+  return std::make_pair(parseOrders(resp->body, orders), orders);
 }
 
 std::pair<Status, Order> Client::cancel_order(const std::string& id) const {
   Order order;
 
-  httplib::SSLClient client(environment_.getAPIBaseURL());
+  auto client = connections_->acquire();
   auto url = "/v2/orders/" + id;
   DLOG(INFO) << "Making request to: " << url;
-  auto resp = client.Delete(url.c_str(), headers(environment_));
+  auto resp = client->Delete(url.c_str(), headers(environment_));
   if (!resp) {
     std::ostringstream ss;
     ss << "Call to " << url << " returned an empty response";
@@ -369,4 +440,60 @@ std::pair<Status, Order> Client::cancel_order(const std::string& id) const {
   return std::make_pair(order.fromJSON(resp->body), order);
 }
 
+std::future<std::pair<Status, Order>> Client::submit_order_async(const std::string& symbol,
+                                                                const int quantity,
+                                                                const OrderSide side,
+                                                                const OrderType type,
+                                                                const OrderTimeInForce tif,
+                                                                const std::string& limit_price,
+                                                                const std::string& stop_price,
+                                                                const bool extended_hours,
+                                                                const std::string& client_order_id,
+                                                                const OrderClass order_class,
+                                                                TakeProfitParams* take_profit_params,
+                                                                StopLossParams* stop_loss_params) const {
+  // the bracket legs are copied, the caller's may be gone by the time the request is sent
+  std::shared_ptr<TakeProfitParams> take_profit;
+  if (take_profit_params != nullptr) {
+    take_profit = std::make_shared<TakeProfitParams>(*take_profit_params);
+  }
+  std::shared_ptr<StopLossParams> stop_loss;
+  if (stop_loss_params != nullptr) {
+    stop_loss = std::make_shared<StopLossParams>(*stop_loss_params);
+  }
+  return dispatch([=](const Client& client) {
+    return client.submit_order(symbol,
+                               quantity,
+                               side,
+                               type,
+                               tif,
+                               limit_price,
+                               stop_price,
+                               extended_hours,
+                               client_order_id,
+                               order_class,
+                               take_profit.get(),
+                               stop_loss.get());
+  });
+}
+
+std::future<std::pair<Status, Order>> Client::replace_order_async(const std::string& id,
+                                                                 const int quantity,
+                                                                 const OrderTimeInForce tif,
+                                                                 const std::string& limit_price,
+                                                                 const std::string& stop_price,
+                                                                 const std::string& client_order_id) const {
+  return dispatch([=](const Client& client) {
+    return client.replace_order(id, quantity, tif, limit_price, stop_price, client_order_id);
+  });
+}
+
+std::future<std::pair<Status, Order>> Client::cancel_order_async(const std::string& id) const {
+  return dispatch([=](const Client& client) { return client.cancel_order(id); });
+}
+
+std::future<std::pair<Status, Order>> Client::get_order_async(const std::string& id, const bool nested) const {
+  return dispatch([=](const Client& client) { return client.get_order(id, nested); });
+}
+
 } // namespace alpaca
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <future>
+#include <memory>
 #include <string>
 #include <utility>
 #include <variant>
@@ -8,9 +10,30 @@
 #include "order.h"
 #include "status.h"
 #include "config.h"
+#include "connection_pool.h"
+#include "dispatcher.h"
 
 namespace alpaca {
 
+/**
+ * @brief Serialize the JSON request body that Client::submit_order sends to
+ * /v2/orders.
+ *
+ * @return the body as a JSON string.
+ */
+std::string submitOrderBody(const std::string& symbol,
+                            const int quantity,
+                            const OrderSide side,
+                            const OrderType type,
+                            const OrderTimeInForce tif,
+                            const std::string& limit_price = "",
+                            const std::string& stop_price = "",
+                            const bool extended_hours = false,
+                            const std::string& client_order_id = "",
+                            const OrderClass order_class = OrderClass::Simple,
+                            TakeProfitParams* take_profit_params = nullptr,
+                            StopLossParams* stop_loss_params = nullptr);
+
 /**
  * @brief The API client object for interacting with the Alpaca Trading API.
  *
@@ -28,8 +51,13 @@ class Client {
  public:
   /**
    * @brief The primary constructor.
+   *
+   * Opens `connections` keep-alive TLS connections to the API base URL before
+   * returning, and every request is then sent over one of them. The *_async
+   * calls run on as many I/O threads. Copies of a Client share the same
+   * connections and threads.
    */
-  explicit Client(Environment& environment);
+  explicit Client(Environment& environment, const std::size_t connections = kDefaultConnections);
 
   /**
    * @brief The default constructor of Client should never be used.
@@ -120,6 +148,41 @@ class Client {
                                        TakeProfitParams* take_profit_params = nullptr,
                                        StopLossParams* stop_loss_params = nullptr) const;
 
+  /**
+   * @brief Submit a basket of Alpaca orders concurrently.
+   *
+   * Every order is sent at once on the Client's I/O threads, so with at least
+   * as many connections as orders the whole basket takes about one round trip.
+   * A failed order doesn't stop the others.
+   *
+   * @code{.cpp}
+   *   auto client = alpaca::Client(env, 50);
+   *   std::vector<alpaca::OrderRequest> basket;
+   *   for (auto& [symbol, quantity] : rebalance) {
+   *     alpaca::OrderRequest request;
+   *     request.symbol = symbol;
+   *     request.quantity = std::abs(quantity);
+   *     request.side = quantity > 0 ? alpaca::OrderSide::Buy : alpaca::OrderSide::Sell;
+   *     basket.push_back(request);
+   *   }
+   *   auto resp = client.submit_orders(basket);
+   *   if (auto status = resp.first; !status.ok()) {
+   *     LOG(ERROR) << "Error submitting basket: " << status.getMessage();
+   *   }
+   *   for (auto& [status, order] : resp.second) {
+   *     if (status.ok()) {
+   *       LOG(INFO) << "Client Order Identifier: " << order.client_order_id;
+   *     }
+   *   }
+   * @endcode
+   *
+   * @return a std::pair where the first element is a Status that fails if any
+   * order failed, naming how many, and the second element holds the Status and
+   * alpaca::Order of each request, in the order of the basket.
+   */
+  std::pair<Status, std::vector<std::pair<Status, Order>>> submit_orders(
+      const std::vector<OrderRequest>& basket) const;
+
   /**
    * @brief Replace an Alpaca order.
    *
@@ -189,7 +252,86 @@ class Client {
    */
   std::pair<Status, Order> cancel_order(const std::string& id) const;
 
+  /**
+   * @brief Submit an Alpaca order without waiting for the response.
+   *
+   * The request is sent from one of the Client's I/O threads over a pooled
+   * connection, so a strategy can have several orders in flight at once.
+   *
+   * @code{.cpp}
+   *   auto pending = client.submit_order_async(
+   *     "NFLX",
+   *     10,
+   *     alpaca::OrderSide::Buy,
+   *     alpaca::OrderType::Market,
+   *     alpaca::OrderTimeInForce::Day
+   *   );
+   *   // ... react to the next tick ...
+   *   auto resp = pending.get();
+   * @endcode
+   *
+   * @return a std::future of what submit_order would have returned.
+   */
+  std::future<std::pair<Status, Order>> submit_order_async(const std::string& symbol,
+                                                          const int quantity,
+                                                          const OrderSide side,
+                                                          const OrderType type,
+                                                          const OrderTimeInForce tif,
+                                                          const std::string& limit_price = "",
+                                                          const std::string& stop_price = "",
+                                                          const bool extended_hours = false,
+                                                          const std::string& client_order_id = "",
+                                                          const OrderClass order_class = OrderClass::Simple,
+                                                          TakeProfitParams* take_profit_params = nullptr,
+                                                          StopLossParams* stop_loss_params = nullptr) const;
+
+  /**
+   * @brief Replace an Alpaca order without waiting for the response.
+   *
+   * @return a std::future of what replace_order would have returned.
+   */
+  std::future<std::pair<Status, Order>> replace_order_async(const std::string& id,
+                                                           const int quantity,
+                                                           const OrderTimeInForce tif,
+                                                           const std::string& limit_price = "",
+                                                           const std::string& stop_price = "",
+                                                           const std::string& client_order_id = "") const;
+
+  /**
+   * @brief Cancel a specific Alpaca order without waiting for the response.
+   *
+   * @return a std::future of what cancel_order would have returned.
+   */
+  std::future<std::pair<Status, Order>> cancel_order_async(const std::string& id) const;
+
+  /**
+   * @brief Fetch a specific Alpaca order without waiting for the response.
+   *
+   * @return a std::future of what get_order would have returned.
+   */
+  std::future<std::pair<Status, Order>> get_order_async(const std::string& id, const bool nested = false) const;
+
  private:
+  /**
+   * @brief Run `call` on an I/O thread with a copy of this Client.
+   *
+   * The copy doesn't share the Dispatcher, so a task never holds the last
+   * reference to the threads it runs on.
+   */
+  template <typename Call>
+  auto dispatch(Call call) const -> std::future<decltype(call(std::declval<const Client&>()))> {
+    using Result = decltype(call(std::declval<const Client&>()));
+    auto self = *this;
+    self.dispatcher_.reset();
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        [self = std::move(self), call = std::move(call)]() { return call(self); });
+    auto result = task->get_future();
+    dispatcher_->post([task]() { (*task)(); });
+    return result;
+  }
+
   Environment environment_;
+  std::shared_ptr<ConnectionPool> connections_;
+  std::shared_ptr<Dispatcher> dispatcher_;
 };
 } // namespace alpaca
@@ -0,0 +1,69 @@
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "connection_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include "httplib.h"
+
+namespace alpaca {
+
+ConnectionPool::ConnectionPool(const std::string& host, const std::size_t size) {
+  for (std::size_t i = 0; i < (size == 0 ? 1 : size); i++) {
+    clients_.emplace_back(new httplib::SSLClient(host));
+    clients_.back()->set_keep_alive(true);
+    idle_.push_back(clients_.back().get());
+  }
+}
+
+ConnectionPool::~ConnectionPool() = default;
+
+ConnectionPool::Lease::Lease(Lease&& other) : pool_(other.pool_), client_(other.client_) {
+  other.pool_ = nullptr;
+  other.client_ = nullptr;
+}
+
+ConnectionPool::Lease::~Lease() {
+  if (pool_ != nullptr) {
+    pool_->release(client_);
+  }
+}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  available_.wait(lock, [this]() { return !idle_.empty(); });
+  auto client = idle_.back();
+  idle_.pop_back();
+  return Lease(this, client);
+}
+
+void ConnectionPool::release(httplib::SSLClient* client) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(client);
+  }
+  available_.notify_one();
+}
+
+std::size_t ConnectionPool::warmUp(const std::function<bool(httplib::SSLClient&)>& request) {
+  std::atomic<std::size_t> connected{0};
+  std::vector<Lease> leases;
+  for (std::size_t i = 0; i < clients_.size(); i++) {
+    leases.push_back(acquire());
+  }
+  std::vector<std::thread> threads;
+  for (auto& lease : leases) {
+    threads.emplace_back([&request, &connected, &lease]() {
+      if (request(*lease)) {
+        connected++;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return connected;
+}
+
+} // namespace alpaca
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace httplib {
+class SSLClient;
+}
+
+namespace alpaca {
+
+/// The number of connections a Client keeps open to the API by default
+const std::size_t kDefaultConnections = 4;
+
+/**
+ * @brief A fixed set of persistent keep-alive TLS connections to one host.
+ *
+ * Each connection is an httplib::SSLClient with keep-alive enabled, so once it
+ * has connected, later requests reuse the same socket and TLS session instead
+ * of paying for DNS, TCP and a handshake again. If the server drops a
+ * connection, httplib reconnects it on its next request. Callers borrow a
+ * connection for one request at a time with acquire(), which waits while all
+ * of them are busy.
+ *
+ * @code{.cpp}
+ *   auto pool = alpaca::ConnectionPool("paper-api.alpaca.markets", 4);
+ *   pool.warmUp([&](httplib::SSLClient& client) { return bool(client.Get("/v2/clock", headers)); });
+ *   auto resp = pool.acquire()->Get("/v2/orders", headers);
+ * @endcode
+ */
+class ConnectionPool {
+ public:
+  /**
+   * @brief A connection borrowed from the pool, returned when it goes out of
+   * scope.
+   */
+  class Lease {
+   public:
+    httplib::SSLClient* operator->() const { return client_; }
+    httplib::SSLClient& operator*() const { return *client_; }
+
+    Lease(ConnectionPool* pool, httplib::SSLClient* client) : pool_(pool), client_(client) {}
+    Lease(Lease&& other);
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    ~Lease();
+
+   private:
+    ConnectionPool* pool_;
+    httplib::SSLClient* client_;
+  };
+
+  /**
+   * @brief Create `size` connections to `host`. No socket is opened until
+   * warmUp or the first request.
+   */
+  ConnectionPool(const std::string& host, const std::size_t size = kDefaultConnections);
+  ~ConnectionPool();
+
+  /**
+   * @brief Borrow a connection, waiting for one to be returned if they are all
+   * in use.
+   */
+  Lease acquire();
+
+  /**
+   * @brief Open every connection now by running `request` on each of them in
+   * parallel, so the first real request doesn't pay for the handshake.
+   *
+   * @return the number of connections for which `request` returned true.
+   */
+  std::size_t warmUp(const std::function<bool(httplib::SSLClient&)>& request);
+
+  std::size_t size() const { return clients_.size(); }
+
+ private:
+  void release(httplib::SSLClient* client);
+
+  std::vector<std::unique_ptr<httplib::SSLClient>> clients_;
+  std::vector<httplib::SSLClient*> idle_;
+  std::mutex mutex_;
+  std::condition_variable available_;
+};
+
+} // namespace alpaca
@@ -0,0 +1,54 @@
+#include "dispatcher.h"
+
+#include <utility>
+
+namespace alpaca {
+
+Dispatcher::Dispatcher(const std::size_t threads) : size_(threads == 0 ? 1 : threads) {}
+
+Dispatcher::~Dispatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void Dispatcher::post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (threads_.empty()) {
+      for (std::size_t i = 0; i < size_; i++) {
+        threads_.emplace_back(&Dispatcher::run, this);
+      }
+    }
+    tasks_.push_back(std::move(task));
+  }
+  ready_.notify_one();
+}
+
+std::size_t Dispatcher::pending() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tasks_.size();
+}
+
+void Dispatcher::run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+} // namespace alpaca
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace alpaca {
+
+/**
+ * @brief A queue of tasks run by a fixed set of I/O threads.
+ *
+ * Client hands its asynchronous calls to a Dispatcher with one thread per
+ * pooled connection, so as many requests as there are connections can be in
+ * flight while the threads that queued them carry on. The threads are started
+ * by the first post().
+ *
+ * @code{.cpp}
+ *   auto dispatcher = alpaca::Dispatcher(4);
+ *   dispatcher.post([]() { LOG(INFO) << "Running on an I/O thread"; });
+ * @endcode
+ */
+class Dispatcher {
+ public:
+  explicit Dispatcher(const std::size_t threads);
+
+  /**
+   * @brief Runs every task that is still queued, then joins the threads.
+   */
+  ~Dispatcher();
+
+  Dispatcher(const Dispatcher&) = delete;
+  Dispatcher& operator=(const Dispatcher&) = delete;
+
+  /**
+   * @brief Queue `task` to run on the next free I/O thread.
+   */
+  void post(std::function<void()> task);
+
+  /**
+   * @brief The number of tasks queued and not yet picked up by a thread.
+   */
+  std::size_t pending();
+
+ private:
+  void run();
+
+  std::size_t size_;
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  bool stopping_ = false;
+};
+
+} // namespace alpaca
@@ -1,5 +1,9 @@
 #include "order.h"
 
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
 #include "json.h"
 #include "rapidjson/document.h"
 
@@ -21,6 +25,8 @@ std::string orderSideToString(const OrderSide side) {
     return "buy";
   case OrderSide::Sell:
     return "sell";
+  case OrderSide::UnknownSide:
+    return "unknown";
   }
   return "none";
 }
@@ -35,6 +41,10 @@ std::string orderTypeToString(const OrderType type) {
     return "stop";
   case OrderType::StopLimit:
     return "stop_limit";
+  case OrderType::TrailingStop:
+    return "trailing_stop";
+  case OrderType::UnknownType:
+    return "unknown";
   }
   return "none";
 }
@@ -53,6 +63,50 @@ std::string orderTimeInForceToString(const OrderTimeInForce tif) {
     return "ioc";
   case OrderTimeInForce::FillOrKill:
     return "fok";
+  case OrderTimeInForce::UnknownTimeInForce:
+    return "unknown";
+  }
+  return "none";
+}
+
+std::string orderStatusToString(const OrderStatus status) {
+  switch (status) {
+  case OrderStatus::New:
+    return "new";
+  case OrderStatus::PartiallyFilled:
+    return "partially_filled";
+  case OrderStatus::Filled:
+    return "filled";
+  case OrderStatus::DoneForDay:
+    return "done_for_day";
+  case OrderStatus::Canceled:
+    return "canceled";
+  case OrderStatus::Expired:
+    return "expired";
+  case OrderStatus::Replaced:
+    return "replaced";
+  case OrderStatus::PendingCancel:
+    return "pending_cancel";
+  case OrderStatus::PendingReplace:
+    return "pending_replace";
+  case OrderStatus::Accepted:
+    return "accepted";
+  case OrderStatus::PendingNew:
+    return "pending_new";
+  case OrderStatus::AcceptedForBidding:
+    return "accepted_for_bidding";
+  case OrderStatus::Stopped:
+    return "stopped";
+  case OrderStatus::Rejected:
+    return "rejected";
+  case OrderStatus::Suspended:
+    return "suspended";
+  case OrderStatus::Calculated:
+    return "calculated";
+  case OrderStatus::Held:
+    return "held";
+  case OrderStatus::UnknownStatus:
+    return "unknown";
   }
   return "none";
 }
@@ -71,40 +125,356 @@ std::string orderClassToString(const OrderClass order_class) {
   return "none";
 }
 
+bool parseFixedPoint(const char* s, std::int64_t& value) {
+  const char* p = s;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') {
+    p++;
+  }
+  std::uint64_t whole = 0;
+  const char* digits = p;
+  for (; *p >= '0' && *p <= '9'; p++) {
+    whole = whole * 10 + (*p - '0');
+    if (whole > static_cast<std::uint64_t>(INT64_MAX / kFixedPointScale)) {
+      return false;
+    }
+  }
+  std::int64_t fraction = 0;
+  std::int64_t unit = kFixedPointScale;
+  if (*p == '.') {
+    p++;
+    // digits past the ninth are dropped
+    for (; *p >= '0' && *p <= '9'; p++) {
+      if (unit > 1) {
+        unit /= 10;
+        fraction += (*p - '0') * unit;
+      }
+    }
+  }
+  if (*p != '\0' || p == digits || (p == digits + 1 && *digits == '.')) {
+    return false;
+  }
+  // the guard above only bounds the whole part, the fraction can still carry the sum past INT64_MAX
+  if (whole > static_cast<std::uint64_t>((INT64_MAX - fraction) / kFixedPointScale)) {
+    return false;
+  }
+  value = static_cast<std::int64_t>(whole) * kFixedPointScale + fraction;
+  if (negative) {
+    value = -value;
+  }
+  return true;
+}
+
+std::string fixedPointToString(const std::int64_t value) {
+  std::uint64_t magnitude = value < 0 ? 0 - static_cast<std::uint64_t>(value) : value;
+  char buffer[32];
+  auto n = std::snprintf(buffer,
+                         sizeof(buffer),
+                         "%s%llu.%09llu",
+                         value < 0 ? "-" : "",
+                         static_cast<unsigned long long>(magnitude / kFixedPointScale),
+                         static_cast<unsigned long long>(magnitude % kFixedPointScale));
+  while (buffer[n - 1] == '0') {
+    n--;
+  }
+  if (buffer[n - 1] == '.') {
+    n--;
+  }
+  return std::string(buffer, n);
+}
+
+namespace {
+
+bool parseDigits(const char*& p, const int count, int& value) {
+  value = 0;
+  for (int i = 0; i < count; i++, p++) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    value = value * 10 + (*p - '0');
+  }
+  return true;
+}
+
+// days since 1970-01-01 of a proleptic Gregorian date
+std::int64_t daysFromCivil(std::int64_t y, const int m, const int d) {
+  y -= m <= 2;
+  std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+  std::int64_t yoe = y - era * 400;
+  std::int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  std::int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+// `unknown` is the enum's last enumerator, every one before it has a string form
+template <typename E>
+E parseEnum(const char* s, const E unknown, std::string (*toString)(const E)) {
+  for (int i = 0; i < static_cast<int>(unknown); i++) {
+    if (toString(static_cast<E>(i)) == s) {
+      return static_cast<E>(i);
+    }
+  }
+  return unknown;
+}
+
+} // namespace
+
+bool parseTimestamp(const char* s, std::int64_t& nanoseconds) {
+  const char* p = s;
+  int year, month, day, hour, minute, second;
+  if (!parseDigits(p, 4, year) || *p++ != '-' || !parseDigits(p, 2, month) || *p++ != '-' ||
+      !parseDigits(p, 2, day) || (*p != 'T' && *p != 't') || !parseDigits(++p, 2, hour) || *p++ != ':' ||
+      !parseDigits(p, 2, minute) || *p++ != ':' || !parseDigits(p, 2, second)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+    return false;
+  }
+  std::int64_t fraction = 0;
+  if (*p == '.') {
+    std::int64_t unit = 1000000000;
+    for (p++; *p >= '0' && *p <= '9'; p++) {
+      if (unit > 1) {
+        unit /= 10;
+        fraction += (*p - '0') * unit;
+      }
+    }
+  }
+  std::int64_t offset = 0;
+  if (*p == 'Z' || *p == 'z') {
+    p++;
+  } else if (*p == '+' || *p == '-') {
+    int sign = *p++ == '-' ? -1 : 1;
+    int offset_hours, offset_minutes;
+    if (!parseDigits(p, 2, offset_hours) || *p++ != ':' || !parseDigits(p, 2, offset_minutes)) {
+      return false;
+    }
+    offset = sign * (offset_hours * 3600 + offset_minutes * 60);
+  } else {
+    return false;
+  }
+  if (*p != '\0') {
+    return false;
+  }
+  std::int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+  nanoseconds = seconds * 1000000000 + fraction;
+  return true;
+}
+
+std::string timestampToString(const std::int64_t nanoseconds) {
+  std::int64_t seconds = nanoseconds / 1000000000;
+  std::int64_t fraction = nanoseconds % 1000000000;
+  if (fraction < 0) {
+    seconds--;
+    fraction += 1000000000;
+  }
+  std::int64_t days = seconds / 86400;
+  std::int64_t rest = seconds % 86400;
+  if (rest < 0) {
+    days--;
+    rest += 86400;
+  }
+  // the inverse of daysFromCivil
+  std::int64_t z = days + 719468;
+  std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  std::int64_t doe = z - era * 146097;
+  std::int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  std::int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  std::int64_t mp = (5 * doy + 2) / 153;
+  std::int64_t day = doy - (153 * mp + 2) / 5 + 1;
+  std::int64_t month = mp < 10 ? mp + 3 : mp - 9;
+  std::int64_t year = yoe + era * 400 + (month <= 2);
+
+  char buffer[48];
+  auto n = std::snprintf(buffer,
+                         sizeof(buffer),
+                         "%04lld-%02lld-%02lldT%02lld:%02lld:%02lld",
+                         static_cast<long long>(year),
+                         static_cast<long long>(month),
+                         static_cast<long long>(day),
+                         static_cast<long long>(rest / 3600),
+                         static_cast<long long>(rest / 60 % 60),
+                         static_cast<long long>(rest % 60));
+  // milliseconds, microseconds or nanoseconds, whichever is exact
+  if (fraction % 1000000 == 0 && fraction != 0) {
+    n += std::snprintf(buffer + n, sizeof(buffer) - n, ".%03lld", static_cast<long long>(fraction / 1000000));
+  } else if (fraction % 1000 == 0 && fraction != 0) {
+    n += std::snprintf(buffer + n, sizeof(buffer) - n, ".%06lld", static_cast<long long>(fraction / 1000));
+  } else if (fraction != 0) {
+    n += std::snprintf(buffer + n, sizeof(buffer) - n, ".%09lld", static_cast<long long>(fraction));
+  }
+  buffer[n++] = 'Z';
+  return std::string(buffer, n);
+}
+
+bool Uuid::parse(const char* s) {
+  std::array<std::uint8_t, 16> parsed;
+  const char* p = s;
+  for (std::size_t i = 0; i < parsed.size(); i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) {
+      if (*p++ != '-') {
+        return false;
+      }
+    }
+    int byte = 0;
+    for (int j = 0; j < 2; j++, p++) {
+      int nibble;
+      if (*p >= '0' && *p <= '9') {
+        nibble = *p - '0';
+      } else if (*p >= 'a' && *p <= 'f') {
+        nibble = *p - 'a' + 10;
+      } else if (*p >= 'A' && *p <= 'F') {
+        nibble = *p - 'A' + 10;
+      } else {
+        return false;
+      }
+      byte = byte << 4 | nibble;
+    }
+    parsed[i] = static_cast<std::uint8_t>(byte);
+  }
+  if (*p != '\0') {
+    return false;
+  }
+  bytes = parsed;
+  return true;
+}
+
+std::string Uuid::toString() const {
+  static const char* kHex = "0123456789abcdef";
+  std::string s;
+  s.reserve(36);
+  for (std::size_t i = 0; i < bytes.size(); i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) {
+      s += '-';
+    }
+    s += kHex[bytes[i] >> 4];
+    s += kHex[bytes[i] & 0xf];
+  }
+  return s;
+}
+
+bool Uuid::empty() const {
+  for (auto byte : bytes) {
+    if (byte != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::ostream& operator<<(std::ostream& os, const Uuid& uuid) {
+  return os << uuid.toString();
+}
+
 Status Order::fromJSON(const std::string& json) {
   rapidjson::Document d;
   if (d.Parse(json.c_str()).HasParseError()) {
     return Status(1, "Received parse error when deserializing order JSON");
   }
 
+  return fromJSON(static_cast<const rapidjson::Value&>(d));
+}
+
+// Each FIELD_* looks the member up once and leaves the field as it was when the
+// member is missing or null. A price, timestamp or UUID that doesn't parse
+// returns an error status; an enum value that isn't known reads as Unknown*.
+#define FIELD_FIXED_POINT(var, name)                                                                                   \
+  if (auto m = d.FindMember(name); m != d.MemberEnd()) {                                                               \
+    if (m->value.IsString()) {                                                                                         \
+      if (!parseFixedPoint(m->value.GetString(), var)) {                                                               \
+        return Status(1, "Couldn't parse " name " of order as a decimal");                                             \
+      }                                                                                                                \
+    } else if (m->value.IsNumber()) {                                                                                  \
+      var = std::llround(m->value.GetDouble() * kFixedPointScale);                                                     \
+    }                                                                                                                  \
+  }
+
+#define FIELD_TIMESTAMP(var, name)                                                                                     \
+  if (auto m = d.FindMember(name); m != d.MemberEnd() && m->value.IsString()) {                                        \
+    if (!parseTimestamp(m->value.GetString(), var)) {                                                                  \
+      return Status(1, "Couldn't parse " name " of order as a timestamp");                                             \
+    }                                                                                                                  \
+  }
+
+#define FIELD_UUID(var, name)                                                                                          \
+  if (auto m = d.FindMember(name); m != d.MemberEnd() && m->value.IsString()) {                                        \
+    if (!var.parse(m->value.GetString())) {                                                                            \
+      return Status(1, "Couldn't parse " name " of order as a UUID");                                                  \
+    }                                                                                                                  \
+  }
+
+#define FIELD_ENUM(var, name, unknown, toString)                                                                       \
+  if (auto m = d.FindMember(name); m != d.MemberEnd() && m->value.IsString()) {                                        \
+    var = parseEnum(m->value.GetString(), unknown, toString);                                                          \
+  }
+
+#define FIELD_STRING(var, name)                                                                                        \
+  if (auto m = d.FindMember(name); m != d.MemberEnd() && m->value.IsString()) {                                        \
+    var.assign(m->value.GetString(), m->value.GetStringLength());                                                      \
+  }
+
+Status Order::fromJSON(const rapidjson::Value& d) {
   if (!d.IsObject()) {
     return Status(1, "Deserialized valid JSON but it wasn't an order object");
   }
 
-  PARSE_STRING(asset_class, "asset_class")
-  PARSE_STRING(asset_id, "asset_id")
-  PARSE_STRING(canceled_at, "canceled_at")
-  PARSE_STRING(client_order_id, "client_order_id")
-  PARSE_STRING(created_at, "created_at")
-  PARSE_STRING(expired_at, "expired_at")
+  FIELD_UUID(id, "id")
+  FIELD_UUID(asset_id, "asset_id")
+  FIELD_STRING(client_order_id, "client_order_id")
+  FIELD_STRING(symbol, "symbol")
+  FIELD_STRING(asset_class, "asset_class")
+
+  FIELD_FIXED_POINT(qty, "qty")
+  FIELD_FIXED_POINT(filled_qty, "filled_qty")
+  FIELD_FIXED_POINT(filled_avg_price, "filled_avg_price")
+  FIELD_FIXED_POINT(limit_price, "limit_price")
+  FIELD_FIXED_POINT(stop_price, "stop_price")
+
+  FIELD_TIMESTAMP(created_at, "created_at")
+  FIELD_TIMESTAMP(updated_at, "updated_at")
+  FIELD_TIMESTAMP(submitted_at, "submitted_at")
+  FIELD_TIMESTAMP(filled_at, "filled_at")
+  FIELD_TIMESTAMP(expired_at, "expired_at")
+  FIELD_TIMESTAMP(canceled_at, "canceled_at")
+  FIELD_TIMESTAMP(failed_at, "failed_at")
+
+  FIELD_ENUM(side, "side", OrderSide::UnknownSide, orderSideToString)
+  FIELD_ENUM(type, "type", OrderType::UnknownType, orderTypeToString)
+  FIELD_ENUM(time_in_force, "time_in_force", OrderTimeInForce::UnknownTimeInForce, orderTimeInForceToString)
+  FIELD_ENUM(status, "status", OrderStatus::UnknownStatus, orderStatusToString)
+
   PARSE_BOOL(extended_hours, "extended_hours")
-  PARSE_STRING(failed_at, "failed_at")
-  PARSE_STRING(filled_at, "filled_at")
-  PARSE_STRING(filled_avg_price, "filled_avg_price")
-  PARSE_STRING(filled_qty, "filled_qty")
-  PARSE_STRING(id, "id")
   PARSE_BOOL(legs, "legs")
-  PARSE_STRING(limit_price, "limit_price")
-  PARSE_STRING(qty, "qty")
-  PARSE_STRING(side, "side")
-  PARSE_STRING(status, "status")
-  PARSE_STRING(stop_price, "stop_price")
-  PARSE_STRING(submitted_at, "submitted_at")
-  PARSE_STRING(symbol, "symbol")
-  PARSE_STRING(time_in_force, "time_in_force")
-  PARSE_STRING(type, "type")
-  PARSE_STRING(updated_at, "updated_at")
 
   return Status();
 }
+
+OrderStrings Order::strings() const {
+  auto price = [](const std::int64_t value) { return value == 0 ? std::string() : fixedPointToString(value); };
+  auto time = [](const std::int64_t value) { return value == 0 ? std::string() : timestampToString(value); };
+
+  OrderStrings s;
+  s.asset_class = asset_class;
+  s.asset_id = asset_id.empty() ? "" : asset_id.toString();
+  s.canceled_at = time(canceled_at);
+  s.client_order_id = client_order_id;
+  s.created_at = time(created_at);
+  s.expired_at = time(expired_at);
+  s.failed_at = time(failed_at);
+  s.filled_at = time(filled_at);
+  s.filled_avg_price = price(filled_avg_price);
+  s.filled_qty = fixedPointToString(filled_qty);
+  s.id = id.empty() ? "" : id.toString();
+  s.limit_price = price(limit_price);
+  s.qty = fixedPointToString(qty);
+  s.side = orderSideToString(side);
+  s.status = orderStatusToString(status);
+  s.stop_price = price(stop_price);
+  s.submitted_at = time(submitted_at);
+  s.symbol = symbol;
+  s.time_in_force = orderTimeInForceToString(time_in_force);
+  s.type = orderTypeToString(type);
+  s.updated_at = time(updated_at);
+  return s;
+}
 } // namespace alpaca
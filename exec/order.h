@@ -1,7 +1,12 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
 #include <string>
 
+#include "rapidjson/fwd.h"
 #include "status.h"
 
 namespace alpaca {
@@ -25,6 +30,8 @@ std::string orderDirectionToString(const OrderDirection direction);
 enum OrderSide {
   Buy,
   Sell,
+  /// A side this version doesn't know, only ever set when reading an order
+  UnknownSide,
 };
 
 /**
@@ -43,6 +50,9 @@ enum OrderType {
   Limit,
   Stop,
   StopLimit,
+  TrailingStop,
+  /// A type this version doesn't know, only ever set when reading an order
+  UnknownType,
 };
 
 /**
@@ -63,6 +73,8 @@ enum OrderTimeInForce {
   CLS,
   ImmediateOrCancel,
   FillOrKill,
+  /// A time in force this version doesn't know, only ever set when reading an order
+  UnknownTimeInForce,
 };
 
 /**
@@ -70,6 +82,40 @@ enum OrderTimeInForce {
  */
 std::string orderTimeInForceToString(const OrderTimeInForce tif);
 
+/**
+ * @brief Where an order is in its lifecycle.
+ *
+ * For the meaning of each status, see:
+ * https://alpaca.markets/docs/trading-on-alpaca/orders/#order-lifecycle
+ */
+enum OrderStatus {
+  New,
+  PartiallyFilled,
+  Filled,
+  DoneForDay,
+  Canceled,
+  Expired,
+  Replaced,
+  PendingCancel,
+  PendingReplace,
+  Accepted,
+  PendingNew,
+  AcceptedForBidding,
+  Stopped,
+  Rejected,
+  Suspended,
+  Calculated,
+  /// Bracket order legs wait in this state until the entry order fills
+  Held,
+  /// A status this version doesn't know
+  UnknownStatus,
+};
+
+/**
+ * @brief A helper to convert an OrderStatus to a string
+ */
+std::string orderStatusToString(const OrderStatus status);
+
 /**
  * @brief The class of the order
  *
@@ -107,33 +153,114 @@ struct StopLossParams {
 };
 
 /**
- * @brief A type representing an Alpaca order.
+ * @brief One order of a basket for Client::submit_orders, with the same fields
+ * Client::submit_order takes.
  */
-class Order {
- public:
+struct OrderRequest {
+  std::string symbol;
+  int quantity = 0;
+  OrderSide side = OrderSide::Buy;
+  OrderType type = OrderType::Market;
+  OrderTimeInForce tif = OrderTimeInForce::Day;
+  std::string limit_price;
+  std::string stop_price;
+  bool extended_hours = false;
+  std::string client_order_id;
+  OrderClass order_class = OrderClass::Simple;
+  /// The advanced order legs, sent only if set
+  std::optional<TakeProfitParams> take_profit;
+  std::optional<StopLossParams> stop_loss;
+};
+
+/// Prices and quantities on an Order are integers in units of 1/kFixedPointScale
+const std::int64_t kFixedPointScale = 1000000000;
+
+/**
+ * @brief A helper to convert a decimal string such as "123.45" to fixed point,
+ * exactly for up to nine decimal places.
+ *
+ * @return false if `s` isn't a decimal number.
+ */
+bool parseFixedPoint(const char* s, std::int64_t& value);
+
+/**
+ * @brief A helper to convert a fixed point value to its shortest decimal
+ * string, e.g. "123.45"
+ */
+std::string fixedPointToString(const std::int64_t value);
+
+/**
+ * @brief A helper to convert a fixed point value to a double, for arithmetic
+ * where exactness doesn't matter
+ */
+inline double fixedPointToDouble(const std::int64_t value) {
+  return static_cast<double>(value) / kFixedPointScale;
+}
+
+/**
+ * @brief A helper to convert an RFC 3339 timestamp such as
+ * "2021-03-16T18:38:01.942282Z" to nanoseconds since the Unix epoch.
+ *
+ * @return false if `s` isn't an RFC 3339 timestamp.
+ */
+bool parseTimestamp(const char* s, std::int64_t& nanoseconds);
+
+/**
+ * @brief A helper to convert nanoseconds since the Unix epoch to an RFC 3339
+ * timestamp in UTC
+ */
+std::string timestampToString(const std::int64_t nanoseconds);
+
+/**
+ * @brief A UUID such as an order or asset identifier, held as its 16 bytes.
+ */
+struct Uuid {
+  std::array<std::uint8_t, 16> bytes{};
+
   /**
-   * @brief A method for deserializing JSON into the current object state.
-   *
-   * @param json The JSON string
+   * @brief Parse the canonical 36 character form.
    *
-   * @return a Status indicating the success or faliure of the operation.
+   * @return false, leaving the bytes unchanged, if `s` isn't a UUID.
    */
-  Status fromJSON(const std::string& json);
+  bool parse(const char* s);
 
- public:
+  /**
+   * @brief The canonical lowercase 36 character form.
+   */
+  std::string toString() const;
+
+  /**
+   * @brief Whether this is the nil UUID, as left by a missing identifier.
+   */
+  bool empty() const;
+
+  bool operator==(const Uuid& other) const {
+    return bytes == other.bytes;
+  }
+  bool operator!=(const Uuid& other) const {
+    return bytes != other.bytes;
+  }
+};
+
+std::ostream& operator<<(std::ostream& os, const Uuid& uuid);
+
+/**
+ * @brief The fields of an Order as the API writes them, all as strings.
+ *
+ * A missing price or timestamp is an empty string.
+ */
+struct OrderStrings {
   std::string asset_class;
   std::string asset_id;
   std::string canceled_at;
   std::string client_order_id;
   std::string created_at;
   std::string expired_at;
-  bool extended_hours;
   std::string failed_at;
   std::string filled_at;
   std::string filled_avg_price;
   std::string filled_qty;
   std::string id;
-  bool legs;
   std::string limit_price;
   std::string qty;
   std::string side;
@@ -145,4 +272,80 @@ class Order {
   std::string type;
   std::string updated_at;
 };
+
+/**
+ * @brief A type representing an Alpaca order.
+ *
+ * Fields are held in their typed form so nothing has to be parsed again to
+ * use them: prices and quantities in fixed point (see kFixedPointScale),
+ * timestamps in nanoseconds since the Unix epoch, identifiers as binary UUIDs
+ * and the side, type, time in force and status as enums. A missing price,
+ * quantity or timestamp is 0. The strings the API sent are rebuilt on demand
+ * by strings().
+ *
+ * @code{.cpp}
+ *   auto notional = alpaca::fixedPointToDouble(order.filled_qty) *
+ *                   alpaca::fixedPointToDouble(order.filled_avg_price);
+ *   if (order.status == alpaca::OrderStatus::Filled) {
+ *     LOG(INFO) << order.id << " filled at " << order.strings().filled_at;
+ *   }
+ * @endcode
+ */
+class Order {
+ public:
+  /**
+   * @brief A method for deserializing JSON into the current object state.
+   *
+   * @param json The JSON string
+   *
+   * @return a Status indicating the success or faliure of the operation.
+   */
+  Status fromJSON(const std::string& json);
+
+  /**
+   * @brief A method for deserializing an already parsed JSON object, such as
+   * one element of a /v2/orders response, into the current object state.
+   *
+   * A side, type, time in force or status this version doesn't recognize is
+   * read as the matching Unknown* enumerator rather than failing the order.
+   *
+   * @param d The JSON object
+   *
+   * @return a Status indicating the success or faliure of the operation.
+   */
+  Status fromJSON(const rapidjson::Value& d);
+
+  /**
+   * @brief The order's fields formatted as the API writes them.
+   */
+  OrderStrings strings() const;
+
+ public:
+  Uuid id;
+  Uuid asset_id;
+  std::string client_order_id;
+  std::string symbol;
+  std::string asset_class;
+
+  std::int64_t qty = 0;
+  std::int64_t filled_qty = 0;
+  std::int64_t filled_avg_price = 0;
+  std::int64_t limit_price = 0;
+  std::int64_t stop_price = 0;
+
+  std::int64_t created_at = 0;
+  std::int64_t updated_at = 0;
+  std::int64_t submitted_at = 0;
+  std::int64_t filled_at = 0;
+  std::int64_t expired_at = 0;
+  std::int64_t canceled_at = 0;
+  std::int64_t failed_at = 0;
+
+  OrderSide side = OrderSide::Buy;
+  OrderType type = OrderType::Market;
+  OrderTimeInForce time_in_force = OrderTimeInForce::Day;
+  OrderStatus status = OrderStatus::New;
+  bool extended_hours = false;
+  bool legs = false;
+};
 } // namespace alpaca
@@ -0,0 +1,144 @@
+#ifndef INGEST_H_
+#define INGEST_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <mongocxx/instance.hpp>
+#include <mongocxx/pool.hpp>
+#include <mongocxx/write_concern.hpp>
+#include <bsoncxx/document/value.hpp>
+
+#include "../database/tick_ring.h"
+
+using namespace std;
+
+// Where level one messages come from. Each message is one JSON object, either a stream frame
+// ({"service": "QUOTE", "content": [{"key": "AAPL", "LAST_PRICE": ...}, ...]}) as tda-api hands
+// to the Python `stream` script, or a single quote object with a "key".
+struct Source {
+  // false once the source is exhausted or the connection is gone
+  virtual bool next(string& message) = 0;
+  virtual ~Source() {}
+};
+
+// newline delimited messages from a TCP feed, e.g. a relay in front of the broker stream
+struct SocketSource : Source {
+  int fd = -1;
+  string buffer;
+  size_t start = 0;
+
+  bool next(string& message) override;
+
+  SocketSource(string host, unsigned short port);
+  ~SocketSource();
+};
+
+// a file of newline delimited messages, replayed at `rate` messages a second (0 for flat out)
+struct ReplaySource : Source {
+  ifstream file;
+  double rate;
+  uint64_t sent = 0;
+  chrono::steady_clock::time_point started;
+
+  bool next(string& message) override;
+
+  ReplaySource(string path, double rate = 0);
+};
+
+// random walk quotes for the tickers, a stand-in for the broker when testing without credentials
+struct StandInSource : Source {
+  vector<string> tickers;
+  vector<double> prices;
+  vector<double> volumes;
+  double rate;
+  // quotes per stream frame
+  unsigned int frame;
+  uint64_t sent = 0;
+  chrono::steady_clock::time_point started;
+  mt19937 random;
+
+  bool next(string& message) override;
+
+  StandInSource(vector<string> tickers, double rate, unsigned int frame = 8);
+};
+
+// Parses level one messages with rapidjson and writes the quotes to their ticker's collection,
+// in the same shape the Python script inserted (every field of the quote plus HOUR, MINUTE and
+// SECOND). Quotes are grouped per collection and written by a pool of writer threads with
+// unordered insert_many, so one slow round trip doesn't hold up parsing. Each collection always
+// goes to the same writer, so its batches are inserted, and given their _ids, in arrival order.
+// A batch is written once it reaches `batch` quotes or has waited `flush`; if `backlog` full
+// batches are already waiting, ingest blocks rather than drop quotes.
+struct Ingester {
+  struct Options {
+    size_t batch = 1000;
+    chrono::milliseconds flush{50};
+    size_t backlog = 64;
+    unsigned int writers = 2;
+    // "majority" or a node count, "0" for unacknowledged writes
+    string write_concern = "1";
+    bool journal = false;
+    // shared memory tick ring to publish every quote to before it is queued for Mongo, empty for none
+    string ring;
+    uint32_t ring_capacity = 1 << 16;
+  };
+
+  Options options;
+  atomic<uint64_t> received{0};
+  atomic<uint64_t> inserted{0};
+  atomic<uint64_t> failed{0};
+  // messages that weren't JSON, or quotes for a ticker that isn't tracked
+  atomic<uint64_t> rejected{0};
+
+  // number of quotes queued from the message, `message` is parsed in place and clobbered
+  size_t ingest(string& message);
+  // write whatever is still queued and stop the writers
+  void stop();
+  // drop every ticker's collection, as the Python script did each morning
+  void drop_collections();
+
+  Ingester(vector<string> tickers, Options options);
+  ~Ingester();
+
+  private:
+    unique_ptr<mongocxx::pool> pool_;
+    string database_name_;
+    mongocxx::write_concern write_concern_;
+    unordered_set<string> tickers_;
+    TickRing ring_;
+
+    // the batches of the tickers one writer owns
+    struct Queue {
+      condition_variable ready;
+      unordered_map<string, vector<bsoncxx::document::value>> pending;
+      deque<pair<string, vector<bsoncxx::document::value>>> full;
+      // last time the partial batches were moved to full
+      chrono::steady_clock::time_point swept;
+    };
+
+    mutex mutex_;
+    condition_variable space_;
+    vector<unique_ptr<Queue>> queues_;
+    // full batches across every queue
+    size_t backlog_ = 0;
+    bool stopping_ = false;
+    vector<thread> writers_;
+
+    void write(Queue& queue);
+};
+
+#endif // INGEST_H_
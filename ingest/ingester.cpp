@@ -0,0 +1,183 @@
+#include "ingest.h"
+#include "../database/database.h"
+
+#include <iostream>
+
+#include <mongocxx/exception/exception.hpp>
+#include <mongocxx/options/insert.hpp>
+#include <mongocxx/uri.hpp>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+
+#include "rapidjson/document.h"
+
+Ingester::Ingester(vector<string> tickers, Options _options) : options(_options), tickers_(tickers.begin(), tickers.end()) {
+  mongo_instance();
+  pool_.reset(new mongocxx::pool(mongocxx::uri{getenv("MONGO_DB_URI")}));
+  database_name_ = getenv("MONGO_DB_DATABASE");
+
+  if (options.write_concern == "majority") write_concern_.majority(chrono::milliseconds(0));
+  else write_concern_.nodes(stoi(options.write_concern));
+  if (options.journal) write_concern_.journal(true);
+
+  if (!options.ring.empty() && !ring_.create(options.ring, options.ring_capacity)) cerr << "Unable to create tick ring " << options.ring << endl;
+
+  if (options.writers == 0) options.writers = 1;
+  for (unsigned int i = 0; i < options.writers; i++) queues_.emplace_back(new Queue());
+  for (unique_ptr<Queue>& queue : queues_) writers_.emplace_back(&Ingester::write, this, ref(*queue));
+}
+
+Ingester::~Ingester() {
+  stop();
+}
+
+void Ingester::drop_collections() {
+  mongocxx::pool::entry client = pool_->acquire();
+  for (const string& ticker : tickers_) (*client)[database_name_][ticker].drop();
+}
+
+static void append_field(bsoncxx::builder::basic::document& document, const rapidjson::Value& name, const rapidjson::Value& value) {
+  bsoncxx::stdx::string_view key(name.GetString(), name.GetStringLength());
+  if (value.IsString()) document.append(kvp(key, bsoncxx::types::b_utf8{bsoncxx::stdx::string_view(value.GetString(), value.GetStringLength())}));
+  else if (value.IsInt()) document.append(kvp(key, value.GetInt()));
+  else if (value.IsInt64()) document.append(kvp(key, value.GetInt64()));
+  else if (value.IsNumber()) document.append(kvp(key, value.GetDouble()));
+  else if (value.IsBool()) document.append(kvp(key, value.GetBool()));
+  // level one quotes are flat, nested values and nulls are left out
+}
+
+static double number(const rapidjson::Value& quote, const char* field) {
+  rapidjson::Value::ConstMemberIterator found = quote.FindMember(field);
+  return found != quote.MemberEnd() && found->value.IsNumber() ? found->value.GetDouble() : 0;
+}
+
+size_t Ingester::ingest(string& message) {
+  rapidjson::Document d;
+  if (d.ParseInsitu(&message[0]).HasParseError() || !d.IsObject()) {
+    rejected++;
+    return 0;
+  }
+
+  const rapidjson::Value* quotes = &d;
+  rapidjson::Value::ConstMemberIterator content = d.FindMember("content");
+  if (content != d.MemberEnd() && content->value.IsArray()) quotes = &content->value;
+
+  // one timestamp for the whole frame, like the Python script stamped each message on arrival
+  Tick tick;
+  tick.time = Clock::current()->now();
+  int64_t seconds = tick.time / NANOS_PER_SECOND;
+  tick.hour = seconds / 3600;
+  tick.minute = seconds / 60 % 60;
+  tick.second = seconds % 60;
+  vector<pair<string, bsoncxx::document::value>> parsed;
+  auto add = [&](const rapidjson::Value& quote) {
+    if (!quote.IsObject()) return;
+    rapidjson::Value::ConstMemberIterator key = quote.FindMember("key");
+    if (key == quote.MemberEnd() || !key->value.IsString()) return;
+    string ticker(key->value.GetString(), key->value.GetStringLength());
+    if (!tickers_.count(ticker)) {
+      rejected++;
+      return;
+    }
+    // quote only updates would leave $first/$last of LAST_PRICE null in the bar pipelines
+    if (!quote.HasMember("LAST_PRICE")) return;
+    bsoncxx::builder::basic::document document;
+    for (rapidjson::Value::ConstMemberIterator field = quote.MemberBegin(); field != quote.MemberEnd(); ++field) {
+      append_field(document, field->name, field->value);
+    }
+    document.append(kvp("HOUR", (int32_t) tick.hour), kvp("MINUTE", (int32_t) tick.minute), kvp("SECOND", (int32_t) tick.second));
+
+    // strategies following the ring see the quote before it is even batched for Mongo
+    if (ring_.isOpen()) {
+      tick.ticker = ticker;
+      tick.last_price = number(quote, "LAST_PRICE");
+      tick.last_size = number(quote, "LAST_SIZE");
+      tick.total_volume = number(quote, "TOTAL_VOLUME");
+      tick.bid_price = number(quote, "BID_PRICE");
+      tick.ask_price = number(quote, "ASK_PRICE");
+      tick.bid_size = number(quote, "BID_SIZE");
+      tick.ask_size = number(quote, "ASK_SIZE");
+      ring_.publish(tick);
+    }
+    parsed.emplace_back(move(ticker), document.extract());
+  };
+  if (quotes->IsArray()) {
+    for (const rapidjson::Value& quote : quotes->GetArray()) add(quote);
+  }
+  else add(*quotes);
+  received += parsed.size();
+  if (parsed.empty()) return 0;
+
+  unique_lock<mutex> lock(mutex_);
+  for (pair<string, bsoncxx::document::value>& quote : parsed) {
+    // two writers inserting batches of one ticker at once would interleave its _ids and its change stream
+    Queue& queue = *queues_[hash<string>()(quote.first) % queues_.size()];
+    vector<bsoncxx::document::value>& batch = queue.pending[quote.first];
+    batch.push_back(move(quote.second));
+    if (batch.size() < options.batch) continue;
+    space_.wait(lock, [this]() { return backlog_ < options.backlog || stopping_; });
+    // the writer may have swept it while we waited
+    if (batch.empty()) continue;
+    queue.full.emplace_back(quote.first, move(batch));
+    batch.clear();
+    backlog_++;
+    queue.ready.notify_one();
+  }
+  return parsed.size();
+}
+
+void Ingester::write(Queue& queue) {
+  mongocxx::pool::entry client = pool_->acquire();
+  mongocxx::options::insert insert;
+  insert.ordered(false);
+  insert.write_concern(write_concern_);
+
+  while (true) {
+    pair<string, vector<bsoncxx::document::value>> batch;
+    {
+      unique_lock<mutex> lock(mutex_);
+      queue.ready.wait_for(lock, options.flush, [&]() { return !queue.full.empty() || stopping_; });
+      // partial batches go out once they've waited a flush interval, even while full ones keep coming
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      if (queue.full.empty() || now - queue.swept >= options.flush) {
+        queue.swept = now;
+        for (pair<const string, vector<bsoncxx::document::value>>& pending : queue.pending) {
+          if (pending.second.empty()) continue;
+          queue.full.emplace_back(pending.first, move(pending.second));
+          pending.second.clear();
+          backlog_++;
+        }
+      }
+      if (queue.full.empty()) {
+        if (stopping_) return;
+        continue;
+      }
+      batch = move(queue.full.front());
+      queue.full.pop_front();
+      backlog_--;
+    }
+    space_.notify_one();
+
+    try {
+      mongocxx::stdx::optional<mongocxx::result::insert_many> result = (*client)[database_name_][batch.first].insert_many(batch.second, insert);
+      // unacknowledged writes come back without a count
+      inserted += result ? result->inserted_count() : batch.second.size();
+    }
+    catch (const mongocxx::exception& e) {
+      // unordered, so the rest of the batch still went in; the error doesn't say how much
+      failed += batch.second.size();
+      cerr << "Insert into " << batch.first << " failed: " << e.what() << endl;
+    }
+  }
+}
+
+void Ingester::stop() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (stopping_) return;
+    stopping_ = true;
+  }
+  for (unique_ptr<Queue>& queue : queues_) queue->ready.notify_all();
+  space_.notify_all();
+  for (thread& writer : writers_) writer.join();
+}
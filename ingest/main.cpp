@@ -0,0 +1,138 @@
+#include "ingest.h"
+#include "../database/database.h"
+
+#include <csignal>
+#include <iostream>
+
+// Level one ingestion daemon, replacing the Python `stream` script's insert_one loop:
+//
+//   ./ingester socket HOST PORT       newline delimited messages from a TCP feed
+//   ./ingester replay FILE [RATE]     replay a capture, RATE messages a second (default flat out)
+//   ./ingester standin RATE           synthetic quotes for every ticker, RATE quotes a second
+//
+// Batching and durability come from INGEST_BATCH, INGEST_FLUSH_MS, INGEST_WRITERS,
+// INGEST_WRITE_CONCERN ("majority" or a node count) and INGEST_JOURNAL. With TICK_RING set, every
+// quote is also published to that shared memory ring for strategies on the same host.
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int) {
+  interrupted = 1;
+}
+
+static const char* env(const char* name, const char* fallback) {
+  const char* value = getenv(name);
+  return value != nullptr ? value : fallback;
+}
+
+// the whole of `text` as a number in [low, high]
+static bool number(const char* text, double low, double high, double& value) {
+  char* end;
+  value = strtod(text, &end);
+  return end != text && *end == '\0' && value >= low && value <= high;
+}
+
+static bool integer(const char* text, double low, double high, unsigned long& value) {
+  double parsed;
+  if (!number(text, low, high, parsed) || parsed != (unsigned long) parsed) return false;
+  value = (unsigned long) parsed;
+  return true;
+}
+
+static int usage(const char* program) {
+  cerr << "usage: " << program << " socket HOST PORT | replay FILE [RATE] | standin RATE" << endl;
+  return 1;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 3) return usage(argv[0]);
+  vector<string> tickers = Database::load_tickers(env("TICKER_PATH", "tickers"));
+  string mode = argv[1];
+
+  unique_ptr<Source> source;
+  // the live feed stops at the close like the Python script did, replays run to the end
+  bool live = mode == "socket";
+  unsigned long port;
+  double rate = 0;
+  if (live)
+  {
+    if (argc != 4 || !integer(argv[3], 1, 65535, port)) return usage(argv[0]);
+    source.reset(new SocketSource(argv[2], port));
+  }
+  else if (mode == "replay")
+  {
+    if (argc > 4 || (argc == 4 && !number(argv[3], 0, numeric_limits<double>::max(), rate))) return usage(argv[0]);
+    source.reset(new ReplaySource(argv[2], rate));
+  }
+  else if (mode == "standin")
+  {
+    if (argc != 3 || !number(argv[2], 0, numeric_limits<double>::max(), rate)) return usage(argv[0]);
+    source.reset(new StandInSource(tickers, rate));
+  }
+  else
+  {
+    cerr << "Unknown source " << mode << endl;
+    return usage(argv[0]);
+  }
+
+  Ingester::Options options;
+  unsigned long batch, flush, writers, nodes;
+  if (!integer(env("INGEST_BATCH", "1000"), 1, 1e9, batch))
+  {
+    cerr << "INGEST_BATCH must be a positive number of quotes" << endl;
+    return 1;
+  }
+  if (!integer(env("INGEST_FLUSH_MS", "50"), 0, 1e9, flush))
+  {
+    cerr << "INGEST_FLUSH_MS must be a number of milliseconds" << endl;
+    return 1;
+  }
+  if (!integer(env("INGEST_WRITERS", "2"), 1, 1024, writers))
+  {
+    cerr << "INGEST_WRITERS must be a positive number of threads" << endl;
+    return 1;
+  }
+  options.write_concern = env("INGEST_WRITE_CONCERN", "1");
+  if (options.write_concern != "majority" && !integer(options.write_concern.c_str(), 0, 1000, nodes))
+  {
+    cerr << "INGEST_WRITE_CONCERN must be majority or a node count" << endl;
+    return 1;
+  }
+  string journal = env("INGEST_JOURNAL", "0");
+  if (journal != "0" && journal != "1")
+  {
+    cerr << "INGEST_JOURNAL must be 0 or 1" << endl;
+    return 1;
+  }
+  options.batch = batch;
+  options.flush = chrono::milliseconds(flush);
+  options.writers = writers;
+  options.journal = journal == "1";
+  options.ring = env("TICK_RING", "");
+  Ingester ingester(tickers, options);
+  // a fresh day starts with empty collections; the bar process rebuilds the index on the drop event
+  if (live) ingester.drop_collections();
+
+  signal(SIGINT, interrupt);
+  signal(SIGTERM, interrupt);
+
+  string message;
+  uint64_t reported = 0;
+  chrono::steady_clock::time_point report = chrono::steady_clock::now();
+  while (!interrupted && source->next(message))
+  {
+    ingester.ingest(message);
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now - report < chrono::seconds(1)) continue;
+    uint64_t received = ingester.received;
+    cout << received - reported << " quotes/s, " << ingester.inserted << " inserted, " << ingester.failed << " failed, "
+         << ingester.rejected << " rejected" << endl;
+    reported = received;
+    report = now;
+    if (live && Time()._time[0] >= 16) break;
+  }
+  ingester.stop();
+  cout << ingester.received << " quotes, " << ingester.inserted << " inserted, " << ingester.failed << " failed" << endl;
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "ingest.h"
+
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <iostream>
+
+SocketSource::SocketSource(string host, unsigned short port) {
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses) != 0) {
+    cerr << "Unable to resolve " << host << endl;
+    return;
+  }
+  for (addrinfo* address = addresses; address != nullptr; address = address->ai_next) {
+    fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) continue;
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) cerr << "Unable to connect to " << host << ":" << port << endl;
+}
+
+SocketSource::~SocketSource() {
+  if (fd >= 0) ::close(fd);
+}
+
+bool SocketSource::next(string& message) {
+  while (true) {
+    size_t end = buffer.find('\n', start);
+    if (end != string::npos) {
+      message.assign(buffer, start, end - start);
+      start = end + 1;
+      return true;
+    }
+    if (fd < 0) return false;
+    // keep the unread tail and read more behind it
+    buffer.erase(0, start);
+    start = 0;
+    size_t size = buffer.size();
+    buffer.resize(size + 65536);
+    ssize_t count = recv(fd, &buffer[size], 65536, 0);
+    if (count <= 0) {
+      buffer.resize(size);
+      ::close(fd);
+      fd = -1;
+      if (buffer.empty()) return false;
+      // the feed closed mid line, hand over what is left
+      message = buffer;
+      buffer.clear();
+      return true;
+    }
+    buffer.resize(size + count);
+  }
+}
+
+// sleep until `sent` messages are due at `rate` a second
+static void pace(double rate, uint64_t sent, chrono::steady_clock::time_point started) {
+  if (rate <= 0) return;
+  chrono::steady_clock::time_point due = started + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(sent / rate));
+  if (due > chrono::steady_clock::now()) this_thread::sleep_until(due);
+}
+
+ReplaySource::ReplaySource(string path, double _rate) : file(path), rate(_rate), started(chrono::steady_clock::now()) {
+  if (!file) cerr << "Unable to open " << path << endl;
+}
+
+bool ReplaySource::next(string& message) {
+  while (getline(file, message)) {
+    if (message.empty()) continue;
+    pace(rate, sent++, started);
+    return true;
+  }
+  return false;
+}
+
+StandInSource::StandInSource(vector<string> _tickers, double _rate, unsigned int _frame)
+  : tickers(_tickers), prices(_tickers.size(), 100), volumes(_tickers.size(), 0), rate(_rate), frame(_frame),
+    started(chrono::steady_clock::now()) {}
+
+bool StandInSource::next(string& message) {
+  if (tickers.empty()) return false;
+  pace(rate, sent, started);
+  uniform_int_distribution<size_t> pick(0, tickers.size() - 1);
+  uniform_int_distribution<int> step(-2, 2);
+  uniform_int_distribution<int> size(1, 20);
+  char quote[256];
+  message = "{\"service\":\"QUOTE\",\"command\":\"SUBS\",\"content\":[";
+  for (unsigned int i = 0; i < frame; i++) {
+    size_t t = pick(random);
+    prices[t] += step(random) * 0.01;
+    if (prices[t] < 1) prices[t] = 1;
+    double last_size = size(random) * 100;
+    volumes[t] += last_size;
+    snprintf(quote, sizeof(quote),
+      "%s{\"key\":\"%s\",\"LAST_PRICE\":%.2f,\"LAST_SIZE\":%.0f,\"BID_PRICE\":%.2f,\"ASK_PRICE\":%.2f,"
+      "\"BID_SIZE\":%d,\"ASK_SIZE\":%d,\"TOTAL_VOLUME\":%.0f}",
+      i == 0 ? "" : ",", tickers[t].c_str(), prices[t], last_size, prices[t] - 0.01, prices[t] + 0.01,
+      size(random) * 100, size(random) * 100, volumes[t]);
+    message += quote;
+  }
+  message += "]}";
+  sent += frame;
+  return true;
+}